@@ -0,0 +1,229 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*       Low-overhead per-chunk execution tracing of parallel transform-reduce operations:       */
+/*       per-thread ring buffers, load-imbalance/idle-time summaries, Chrome trace export.       */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <string>
+#include <map>
+
+namespace {
+
+	// one executed chunk: element range [first, last) of a run, processed by a thread
+	struct chunk_event {
+		std::uint64_t begin;	// ns since the tracer was created
+		std::uint64_t end;
+		std::uint64_t first;
+		std::uint64_t last;
+		std::uint32_t run;
+		std::uint32_t thread;
+	};
+
+	// per run statistics, averaged over the traced runs
+	struct trace_summary {
+		size_t runs{ 0u };		// runs summarized
+		double threads{ 0.0 };		// threads that executed at least one chunk
+		double imbalance{ 0.0 };	// busiest thread time / mean time of the available threads, 1 is perfect balance
+		double idle{ 0.0 };		// fraction of available threads x wall-time not spent in chunks
+		double straggler{ 0.0 };	// slowest chunk time / mean chunk time
+	};
+
+	// the traced chunks of one measurement, ready for export
+	struct chunk_trace {
+		std::string label;
+		std::vector<chunk_event> events;
+	};
+
+	class chunk_tracer {
+	public:
+
+		// rings are allocated up front, so that recording neither locks nor allocates;
+		// a thread claims its ring on its first record() with one relaxed atomic increment
+		explicit chunk_tracer(size_t capacity_per_thread = 2048u,
+			size_t max_threads = std::max(64u, 2u * std::thread::hardware_concurrency())) :
+			id_(next_id_.fetch_add(1u, std::memory_order_relaxed)),
+			epoch_(std::chrono::steady_clock::now()),
+			mask_(ceil_pow2(capacity_per_thread) - 1u),
+			rings_(max_threads) {
+			for (auto& r : rings_) r.events.reset(new chunk_event[mask_ + 1u]);
+		}
+		chunk_tracer(const chunk_tracer&) = delete;
+		auto operator=(const chunk_tracer&)->chunk_tracer& = delete;
+
+		auto now() const->std::uint64_t {
+			return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - epoch_).count());
+		}
+
+		// called by the thread that executed the chunk, only touches that thread's ring;
+		// a relaxed read-modify-write of a lock-free atomic is the only synchronization,
+		// which par_unseq element access functions may perform; the chunks of a thread
+		// that found no free ring are not traced, see untraced_threads()
+		auto record(std::uint32_t run, size_t first, size_t last, std::uint64_t begin, std::uint64_t end)->void {
+			auto r{ local_ring() };
+			if (r == nullptr) return;
+			r->events[r->count & mask_] = chunk_event{ begin, end, first, last, run, r->thread };
+			++r->count;
+		}
+
+		// forgets the recorded events, thread registrations are kept;
+		// must not run concurrently with record()
+		auto clear()->void {
+			for (auto& r : rings_) r.count = 0u;
+		}
+
+		// events of the runs retained completely by every ring, ordered by start time;
+		// must not run concurrently with record()
+		auto events() const->std::vector<chunk_event> {
+			std::uint32_t complete_from{ 0u };
+			for (auto& r : rings_)
+				if (r.count > mask_ + 1u)
+					complete_from = std::max(complete_from, r.events[r.count & mask_].run + 1u);
+
+			std::vector<chunk_event> retained;
+			for (auto& r : rings_) {
+				const std::uint64_t n{ std::min<std::uint64_t>(r.count, mask_ + 1u) };
+				for (auto k{ r.count - n }; k < r.count; ++k)
+					if (r.events[k & mask_].run >= complete_from) retained.push_back(r.events[k & mask_]);
+			}
+			std::sort(std::begin(retained), std::end(retained),
+				[](const chunk_event& x, const chunk_event& y) { return x.begin < y.begin; });
+			return retained;
+		}
+
+		// number of threads that found no free ring, their chunks were not traced
+		auto untraced_threads() const->size_t {
+			auto claimed{ next_slot_.load(std::memory_order_relaxed) };
+			return claimed > rings_.size() ? claimed - rings_.size() : 0u;
+		}
+
+		// imbalance and idle time are relative to all threads available to the runs,
+		// so threads that executed no chunk count as idle; only runs whose traced chunks
+		// cover all elements are summarized, runs that lost chunks would distort the figures
+		static auto summarize(const std::vector<chunk_event>& events, size_t available_threads, size_t elements)->trace_summary {
+			std::map<std::uint32_t, std::vector<const chunk_event*> > runs;
+			for (auto& e : events) runs[e.run].push_back(&e);
+
+			trace_summary summary;
+			for (auto& [run, chunks] : runs) {
+				std::uint64_t covered{ 0u };
+				for (auto e : chunks) covered += e->last - e->first;
+				if (covered != elements) continue;
+
+				std::uint64_t begin{ chunks.front()->begin }, end{ chunks.front()->end }, longest{ 0u }, total{ 0u };
+				std::map<std::uint32_t, std::uint64_t> busy;
+				for (auto e : chunks) {
+					begin = std::min(begin, e->begin);
+					end = std::max(end, e->end);
+					longest = std::max(longest, e->end - e->begin);
+					total += e->end - e->begin;
+					busy[e->thread] += e->end - e->begin;
+				}
+				std::uint64_t busiest{ 0u };
+				for (auto& [thread, t] : busy) busiest = std::max(busiest, t);
+
+				const double threads{ static_cast<double>(std::max(available_threads, busy.size())) };
+				const double wall{ static_cast<double>(std::max<std::uint64_t>(end - begin, 1u)) };
+				const double mean_busy{ std::max(static_cast<double>(total) / threads, 1.0) };
+				const double mean_chunk{ std::max(static_cast<double>(total) / static_cast<double>(chunks.size()), 1.0) };
+
+				summary.threads += static_cast<double>(busy.size());
+				summary.imbalance += static_cast<double>(busiest) / mean_busy;
+				summary.idle += 1.0 - static_cast<double>(total) / (threads * wall);
+				summary.straggler += static_cast<double>(longest) / mean_chunk;
+				++summary.runs;
+			}
+
+			if (summary.runs > 0u) {
+				const double n{ static_cast<double>(summary.runs) };
+				summary.threads /= n;
+				summary.imbalance /= n;
+				summary.idle /= n;
+				summary.straggler /= n;
+			}
+			return summary;
+		}
+
+		// Chrome trace / Perfetto JSON, one process per trace and one track per thread
+		static auto export_chrome_trace(std::ostream& os, const std::vector<chunk_trace>& traces)->void {
+			const auto flags{ os.flags() };
+			const auto precision{ os.precision() };
+			os << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+			bool separator{ false };
+			auto next = [&os, &separator]() -> std::ostream& {
+				if (separator) os << ",";
+				separator = true;
+				return os << "\n";
+			};
+			for (size_t pid{ 0u }; pid < traces.size(); ++pid) {
+				next() << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+					<< ",\"args\":{\"name\":\"" << traces[pid].label << "\"}}";
+				for (auto& e : traces[pid].events) {
+					next() << "{\"name\":\"chunk [" << e.first << ", " << e.last << ")\""
+						<< ",\"cat\":\"transform_reduce\",\"ph\":\"X\""
+						<< ",\"ts\":" << static_cast<double>(e.begin) / 1000.0
+						<< ",\"dur\":" << static_cast<double>(e.end - e.begin) / 1000.0
+						<< ",\"pid\":" << pid
+						<< ",\"tid\":" << e.thread
+						<< ",\"args\":{\"run\":" << e.run << ",\"first\":" << e.first << ",\"last\":" << e.last << "}}";
+				}
+			}
+			os << "\n]}\n";
+			os.flags(flags);
+			os.precision(precision);
+		}
+
+	private:
+		// one cache line at least, so that threads recording into neighbouring rings
+		// do not share the line holding their counts
+		struct alignas(64) ring {
+			std::unique_ptr<chunk_event[]> events;
+			std::uint64_t count{ 0u };
+			std::uint32_t thread{ 0u };
+		};
+
+		static constexpr auto ceil_pow2(size_t n)->size_t {
+			size_t p{ 1u };
+			while (p < n) p <<= 1u;
+			return p;
+		}
+
+		// ring owned by the calling thread, claimed on first use
+		auto local_ring()->ring* {
+			struct cache {
+				std::uint64_t tracer{ 0u };
+				ring* r{ nullptr };
+			};
+			thread_local cache c;
+			if (c.tracer != id_) {
+				auto slot{ next_slot_.fetch_add(1u, std::memory_order_relaxed) };
+				c.tracer = id_;
+				c.r = slot < rings_.size() ? &rings_[slot] : nullptr;
+				if (c.r != nullptr) c.r->thread = static_cast<std::uint32_t>(slot);
+			}
+			return c.r;
+		}
+
+		static inline std::atomic<std::uint64_t> next_id_{ 1u };
+
+		const std::uint64_t id_;
+		const std::chrono::steady_clock::time_point epoch_;
+		const size_t mask_;
+		std::vector<ring> rings_;
+		std::atomic<size_t> next_slot_{ 0u };
+		static_assert(std::atomic<size_t>::is_always_lock_free);
+	};
+}
@@ -0,0 +1,70 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*     Run-time detection of the SIMD instruction sets of the host CPU, so that the hand-        */
+/*    vectorized kernels can be compiled in without making the whole program require them.       */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// instruction sets the kernels are compiled for: MSVC accepts the intrinsics on x64
+// without /arch, GCC and Clang only when the build enables the instruction set
+#if defined(__AVX2__) || (defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64))
+#define SIMD_KERNELS_AVX2
+#endif
+#if defined(__AVX512F__) || (defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64))
+#define SIMD_KERNELS_AVX512
+#endif
+#if defined(__FMA__) || (defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64))
+#define SIMD_KERNELS_FMA
+#endif
+#if defined(__F16C__) || (defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64))
+#define SIMD_KERNELS_F16C
+#endif
+
+namespace {
+
+	// instruction sets supported by the CPU and enabled by the operating system
+	struct cpu_features {
+		bool avx2{ false };
+		bool fma{ false };
+		bool f16c{ false };
+		bool avx512f{ false };
+	};
+
+	inline auto detect_cpu_features()->cpu_features {
+		cpu_features f;
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+		int r[4];
+		__cpuid(r, 0);
+		const int max_leaf{ r[0] };
+		__cpuid(r, 1);
+		const int ecx{ r[2] };
+		if ((ecx & (1 << 27)) == 0 || (ecx & (1 << 28)) == 0) return f;		// no OSXSAVE or no AVX
+		const unsigned long long xcr0{ _xgetbv(0) };
+		if ((xcr0 & 0x6u) != 0x6u) return f;					// YMM state not enabled by the OS
+		f.fma = (ecx & (1 << 12)) != 0;
+		f.f16c = (ecx & (1 << 29)) != 0;
+		if (max_leaf >= 7) {
+			__cpuidex(r, 7, 0);
+			f.avx2 = (r[1] & (1 << 5)) != 0;
+			f.avx512f = (r[1] & (1 << 16)) != 0 && (xcr0 & 0xe6u) == 0xe6u;	// and ZMM/opmask state
+		}
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		f.avx2 = __builtin_cpu_supports("avx2");
+		f.fma = __builtin_cpu_supports("fma");
+		f.f16c = __builtin_cpu_supports("f16c");
+		f.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+		return f;
+	}
+
+	// the host CPU, detected once at start-up
+	inline const cpu_features host_cpu{ detect_cpu_features() };
+}
@@ -0,0 +1,250 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*          Masked (filter predicate) and indexed (gather) transform-reduce performance          */
+/*        tests based on data type, selectivity, and index locality of the selected elements.    */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <algorithm>
+#include <execution>
+#include <valarray>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <limits>
+#include <tuple>
+#include <cmath>
+
+#include "simd_kernels.h"
+#include "tester_utilities.h"
+
+namespace {
+
+	// a platform for testing transform-reduce over a subset of the data,
+	// selected either by a boolean mask or by an index list
+	//
+	// every result is { number of tests, size of data, selectivity, run-time }
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto masked_gather_transform_reduce_test(
+		const std::vector<size_t>& nIter,
+		const std::vector<size_t>& szData,
+		const std::vector<double>& selectivity)->std::tuple<
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >
+		> {
+		if constexpr (std::is_arithmetic_v<T> &&
+			std::is_invocable_r_v<T, BinOpReduce<T>, const T&, const T&> &&
+			std::is_invocable_r_v<T, BinOpTransform<T>, const T&, const T&>) {
+
+			constexpr T identity{ reduction_identity<T, BinOpReduce>() };
+
+			// tests result
+			std::vector<std::tuple<size_t, size_t, double, double> > test_9_results;
+			std::vector<std::tuple<size_t, size_t, double, double> > test_10_results;
+			std::vector<std::tuple<size_t, size_t, double, double> > test_11_results;
+			std::vector<std::tuple<size_t, size_t, double, double> > test_12_results;
+			std::vector<std::tuple<size_t, size_t, double, double> > test_13_results;
+			std::vector<std::tuple<size_t, size_t, double, double> > test_14_results;
+			std::vector<std::tuple<size_t, size_t, double, double> > test_15_results;
+
+			// random number distribution preparation
+			std::random_device rd;
+			std::default_random_engine rng{ rd() };
+
+			// test case std::valarrays initialization by uniform distributed random numbers
+			auto random_data = [&rng](size_t n) {
+				std::valarray<T> a(T(0), n), b(T(0), n);
+				if constexpr (std::is_integral_v<T>) {
+					constexpr T lower_limit = std::numeric_limits<T>::min(), upper_limit = std::numeric_limits<T>::max();
+					std::uniform_int_distribution<T> rnd(lower_limit, upper_limit);
+					std::generate(std::begin(a), std::end(a), [&rng, &rnd]() { return rnd(rng); });
+					std::generate(std::begin(b), std::end(b), [&rng, &rnd]() { return rnd(rng); });
+				}
+				else if constexpr (std::is_floating_point_v<T>) {
+					constexpr T lower_limit = T(0), upper_limit = T(1);
+					std::uniform_real_distribution<T> rnd(lower_limit, upper_limit);
+					std::generate(std::begin(a), std::end(a), [&rng, &rnd]() { return rnd(rng); });
+					std::generate(std::begin(b), std::end(b), [&rng, &rnd]() { return rnd(rng); });
+				}
+				return std::make_pair(std::move(a), std::move(b));
+			};
+
+			// filter predicate: each element is selected with probability s
+			auto random_mask = [&rng](size_t n, double s) {
+				std::valarray<bool> mask(false, n);
+				std::bernoulli_distribution rnd(s);
+				std::generate(std::begin(mask), std::end(mask), [&rng, &rnd]() { return rnd(rng); });
+				return mask;
+			};
+
+			// index list: round(s * n) distinct indices, either ascending (good
+			// locality, every cache line is visited once in order) or shuffled
+			auto random_indices = [&rng](size_t n, double s, bool ascending) {
+				std::vector<size_t> all(n);
+				std::iota(std::begin(all), std::end(all), size_t(0));
+				std::shuffle(std::begin(all), std::end(all), rng);
+				auto m{ static_cast<size_t>(std::llround(s * static_cast<double>(n))) };
+				std::valarray<size_t> idx(all.data(), std::min(m, n));
+				if (ascending) std::sort(std::begin(idx), std::end(idx));
+				return idx;
+			};
+
+			// test 9 { std::valarray<T>[std::valarray<bool>] -> std::transform_reduce(seq,...) }
+			auto mask_array_transform_reduce = [](const std::valarray<T>& a, const std::valarray<T>& b, const std::valarray<bool>& mask) {
+				std::valarray<T> am(a[mask]), bm(b[mask]);
+				return std::transform_reduce(std::execution::seq,
+					std::begin(am),
+					std::end(am),
+					std::begin(bm),
+					reduction_identity<T, BinOpReduce>(),
+					BinOpReduce<T>(),
+					BinOpTransform<T>());
+			};
+
+			// test 10 { branchless predicated (SIMD) transform-reduce }
+			auto predicated = [](const std::valarray<T>& a, const std::valarray<T>& b, const std::valarray<bool>& mask) {
+				return predicated_transform_reduce<T, BinOpReduce, BinOpTransform>(std::begin(a), std::begin(b), std::begin(mask), a.size());
+			};
+
+			// test 11 { compaction -> dense std::transform_reduce(seq,...) }
+			auto compacted = [](const std::valarray<T>& a, const std::valarray<T>& b, const std::valarray<bool>& mask,
+				std::valarray<T>& ca, std::valarray<T>& cb) {
+				auto m{ compact(std::begin(a), std::begin(b), std::begin(mask), a.size(), std::begin(ca), std::begin(cb)) };
+				return std::transform_reduce(std::execution::seq,
+					std::begin(ca),
+					std::begin(ca) + m,
+					std::begin(cb),
+					reduction_identity<T, BinOpReduce>(),
+					BinOpReduce<T>(),
+					BinOpTransform<T>());
+			};
+
+			// tests 12, 14 { std::valarray<T>[std::valarray<size_t>] -> std::transform_reduce(seq,...) }
+			auto indirect_array_transform_reduce = [](const std::valarray<T>& a, const std::valarray<T>& b, const std::valarray<size_t>& idx) {
+				std::valarray<T> ag(a[idx]), bg(b[idx]);
+				return std::transform_reduce(std::execution::seq,
+					std::begin(ag),
+					std::end(ag),
+					std::begin(bg),
+					reduction_identity<T, BinOpReduce>(),
+					BinOpReduce<T>(),
+					BinOpTransform<T>());
+			};
+
+			// tests 13, 15 { AVX2/AVX-512 gather transform-reduce }
+			auto gathered = [](const std::valarray<T>& a, const std::valarray<T>& b, const std::valarray<size_t>& idx) {
+				return gather_transform_reduce<T, BinOpReduce, BinOpTransform>(std::begin(a), std::begin(b), std::begin(idx), idx.size());
+			};
+
+			// correctness of results validation
+			auto validation = [&, n = szData[0u]]()->bool {
+				auto data{ random_data(n) };
+				auto& a{ data.first };
+				auto& b{ data.second };
+				auto mask{ random_mask(n, 0.5) };
+				auto idx{ random_indices(n, 0.5, false) };
+				std::valarray<T> ca(T(0), n), cb(T(0), n);
+
+				// plain scalar references
+				T masked_reference{ identity }, gather_reference{ identity };
+				for (size_t k{ 0u }; k < n; ++k)
+					if (mask[k]) masked_reference = BinOpReduce<T>()(masked_reference, BinOpTransform<T>()(a[k], b[k]));
+				for (size_t k{ 0u }; k < idx.size(); ++k)
+					gather_reference = BinOpReduce<T>()(gather_reference, BinOpTransform<T>()(a[idx[k]], b[idx[k]]));
+
+				// SIMD kernels change the order of evaluation
+				return same_result(mask_array_transform_reduce(a, b, mask), masked_reference, n) &&
+					same_result(predicated(a, b, mask), masked_reference, n) &&
+					same_result(compacted(a, b, mask, ca, cb), masked_reference, n) &&
+					same_result(indirect_array_transform_reduce(a, b, idx), gather_reference, n) &&
+					same_result(gathered(a, b, idx), gather_reference, n);
+			};
+			if (validation()) {
+
+				// test procedure...
+				for (auto i : nIter) {
+					for (auto j : szData) {
+
+						// test cases data structures
+						auto data{ random_data(j) };
+						auto& a{ data.first };
+						auto& b{ data.second };
+						std::valarray<T> ca(T(0), j), cb(T(0), j);
+
+						for (auto s : selectivity) {
+							auto mask{ random_mask(j, s) };
+							auto idx_ascending{ random_indices(j, s, true) };
+							auto idx_shuffled{ random_indices(j, s, false) };
+
+							/*******************************************************************************/
+							/*                  test 9 { std::valarray<T>::operator[](mask) }               */
+							/*******************************************************************************/
+							test_9_results.push_back(std::make_tuple(i, j, s,
+								timed_repetitions(i, [&]() { return mask_array_transform_reduce(a, b, mask); })));
+
+							/*******************************************************************************/
+							/*                 test 10 { branchless predicated transform-reduce }           */
+							/*******************************************************************************/
+							test_10_results.push_back(std::make_tuple(i, j, s,
+								timed_repetitions(i, [&]() { return predicated(a, b, mask); })));
+
+							/*******************************************************************************/
+							/*              test 11 { compaction + dense std::transform_reduce }            */
+							/*******************************************************************************/
+							test_11_results.push_back(std::make_tuple(i, j, s,
+								timed_repetitions(i, [&]() { return compacted(a, b, mask, ca, cb); })));
+
+							/*******************************************************************************/
+							/*     test 12 { std::valarray<T>::operator[](indices), ascending indices }     */
+							/*******************************************************************************/
+							test_12_results.push_back(std::make_tuple(i, j, s,
+								timed_repetitions(i, [&]() { return indirect_array_transform_reduce(a, b, idx_ascending); })));
+
+							/*******************************************************************************/
+							/*              test 13 { SIMD gather transform-reduce, ascending indices }     */
+							/*******************************************************************************/
+							test_13_results.push_back(std::make_tuple(i, j, s,
+								timed_repetitions(i, [&]() { return gathered(a, b, idx_ascending); })));
+
+							/*******************************************************************************/
+							/*     test 14 { std::valarray<T>::operator[](indices), shuffled indices }      */
+							/*******************************************************************************/
+							test_14_results.push_back(std::make_tuple(i, j, s,
+								timed_repetitions(i, [&]() { return indirect_array_transform_reduce(a, b, idx_shuffled); })));
+
+							/*******************************************************************************/
+							/*              test 15 { SIMD gather transform-reduce, shuffled indices }      */
+							/*******************************************************************************/
+							test_15_results.push_back(std::make_tuple(i, j, s,
+								timed_repetitions(i, [&]() { return gathered(a, b, idx_shuffled); })));
+						}
+					}
+				}
+
+				return std::make_tuple(
+					std::move(test_9_results),
+					std::move(test_10_results),
+					std::move(test_11_results),
+					std::move(test_12_results),
+					std::move(test_13_results),
+					std::move(test_14_results),
+					std::move(test_15_results));
+			}
+			else
+				throw std::exception("Exception: Masked/gather correcteness test results don't have same values.");
+		}
+	}
+}
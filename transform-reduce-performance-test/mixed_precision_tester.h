@@ -0,0 +1,200 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*     Mixed-precision transform-reduce performance tests: the elements are stored in a narrow   */
+/*    floating-point type and accumulated in a wider one, measured against a double reference.   */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <algorithm>
+#include <execution>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <limits>
+#include <thread>
+#include <tuple>
+#include <cmath>
+
+#include "narrow_float.h"
+#include "simd_kernels.h"
+#include "tester_utilities.h"
+
+namespace {
+
+	// a platform for testing transform-reduce with storage type S and accumulator type A
+	//
+	// every result is { number of tests, size of data, run-time, throughput (GB/s of stored input),
+	// relative error against the double reference of the unrounded data,
+	// relative error against the double reference of the stored data }
+	template<typename S, typename A,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto mixed_precision_transform_reduce_test(
+		const std::vector<size_t>& nIter,
+		const std::vector<size_t>& szData)->std::tuple<
+		std::vector<std::tuple<size_t, size_t, double, double, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double, double, double> >
+		> {
+		if constexpr (is_storage_float_v<S> && std::is_floating_point_v<A> &&
+			std::is_same_v<BinOpReduce<A>, std::plus<A> >) {
+
+			// tests result
+			std::vector<std::tuple<size_t, size_t, double, double, double, double> > test_27_results;
+			std::vector<std::tuple<size_t, size_t, double, double, double, double> > test_28_results;
+			std::vector<std::tuple<size_t, size_t, double, double, double, double> > test_29_results;
+			std::vector<std::tuple<size_t, size_t, double, double, double, double> > test_30_results;
+
+			// random number distribution preparation
+			std::random_device rd;
+			std::default_random_engine rng{ rd() };
+
+			// test case data: double precision originals and their narrow stored copies
+			struct test_data {
+				std::vector<double> a, b;
+				std::vector<S> sa, sb;
+			};
+			auto random_data = [&rng](size_t n) {
+				test_data d{ std::vector<double>(n), std::vector<double>(n), std::vector<S>(n), std::vector<S>(n) };
+				constexpr double lower_limit = 0.0, upper_limit = 1.0;
+				std::uniform_real_distribution<double> rnd(lower_limit, upper_limit);
+				std::generate(std::begin(d.a), std::end(d.a), [&rng, &rnd]() { return rnd(rng); });
+				std::generate(std::begin(d.b), std::end(d.b), [&rng, &rnd]() { return rnd(rng); });
+				std::transform(std::begin(d.a), std::end(d.a), std::begin(d.sa), [](double x) { return S(static_cast<float>(x)); });
+				std::transform(std::begin(d.b), std::end(d.b), std::begin(d.sb), [](double x) { return S(static_cast<float>(x)); });
+				return d;
+			};
+
+			// transformation of two stored elements in the accumulator type
+			auto converting_transform = [](const S& x, const S& y) {
+				return BinOpTransform<A>()(to_accumulator<A>(x), to_accumulator<A>(y));
+			};
+
+			// test 27 { std::transform_reduce(seq,...), converting transformation }
+			auto mixed_seq = [converting_transform](const std::vector<S>& a, const std::vector<S>& b) {
+				return std::transform_reduce(std::execution::seq,
+					std::begin(a),
+					std::end(a),
+					std::begin(b),
+					A(0),
+					std::plus<A>(),
+					converting_transform);
+			};
+
+			// test 28 { std::transform_reduce(par,...), converting transformation }
+			auto mixed_par = [converting_transform](const std::vector<S>& a, const std::vector<S>& b) {
+				return std::transform_reduce(std::execution::par,
+					std::begin(a),
+					std::end(a),
+					std::begin(b),
+					A(0),
+					std::plus<A>(),
+					converting_transform);
+			};
+
+			// test 29 { SIMD convert + FMA transform-reduce }
+			auto mixed_simd = [](const std::vector<S>& a, const std::vector<S>& b) {
+				return mixed_precision_transform_reduce<S, A, BinOpReduce, BinOpTransform>(a.data(), b.data(), a.size());
+			};
+
+			// test 30 { SIMD convert + FMA transform-reduce on chunks, chunks reduced by std::transform_reduce(par,...) }
+			auto mixed_par_simd = [chunks = chunk_indices(4u)](const std::vector<S>& a, const std::vector<S>& b) {
+				return chunked_transform_reduce(std::execution::par, chunks, a.size(), A(0), std::plus<A>(),
+					[&a, &b](size_t lo, size_t hi) {
+						return mixed_precision_transform_reduce<S, A, BinOpReduce, BinOpTransform>(a.data() + lo, b.data() + lo, hi - lo);
+					});
+			};
+
+			// double precision references of the original and of the stored data
+			auto references = [](const test_data& d) {
+				auto original{ std::transform_reduce(std::execution::seq,
+					std::begin(d.a),
+					std::end(d.a),
+					std::begin(d.b),
+					0.0,
+					std::plus<double>(),
+					BinOpTransform<double>()) };
+				auto stored{ std::transform_reduce(std::execution::seq,
+					std::begin(d.sa),
+					std::end(d.sa),
+					std::begin(d.sb),
+					0.0,
+					std::plus<double>(),
+					[](const S& x, const S& y) { return BinOpTransform<double>()(to_accumulator<double>(x), to_accumulator<double>(y)); }) };
+				return std::make_pair(original, stored);
+			};
+
+			auto relative_error = [](A x, double reference) {
+				return std::abs(static_cast<double>(x) - reference) / std::max(std::abs(reference), std::numeric_limits<double>::min());
+			};
+
+			// correctness of results validation: every implementation must lie within
+			// the worst-case accumulation error bound of the stored-data reference
+			auto validation = [&, n = szData[0u]]()->bool {
+				auto d{ random_data(n) };
+				auto reference{ references(d).second };
+				const double bound{ 2.0 * static_cast<double>(n) * static_cast<double>(std::numeric_limits<A>::epsilon()) };
+				return relative_error(mixed_seq(d.sa, d.sb), reference) <= bound &&
+					relative_error(mixed_par(d.sa, d.sb), reference) <= bound &&
+					relative_error(mixed_simd(d.sa, d.sb), reference) <= bound &&
+					relative_error(mixed_par_simd(d.sa, d.sb), reference) <= bound;
+			};
+			if (validation()) {
+
+				// run-time, throughput and errors of i repetitions of f
+				auto speed_test = [&](size_t i, const test_data& d, auto&& f) {
+					auto Δt{ timed_repetitions(i, [&f, &d]() { return f(d.sa, d.sb); }) };
+
+					const double bytes{ 2.0 * static_cast<double>(i) * static_cast<double>(d.sa.size()) * static_cast<double>(sizeof(S)) };
+					auto [original, stored] = references(d);
+					auto result{ f(d.sa, d.sb) };
+					return std::make_tuple(Δt, bytes / Δt * 1e-9, relative_error(result, original), relative_error(result, stored));
+				};
+
+				// test procedure...
+				for (auto i : nIter) {
+					for (auto j : szData) {
+
+						// test cases data structures
+						auto d{ random_data(j) };
+
+						/*******************************************************************************/
+						/*           test 27 { std::transform_reduce(seq,...), mixed precision }       */
+						/*******************************************************************************/
+						test_27_results.push_back(std::tuple_cat(std::make_tuple(i, j), speed_test(i, d, mixed_seq)));
+
+						/*******************************************************************************/
+						/*           test 28 { std::transform_reduce(par,...), mixed precision }       */
+						/*******************************************************************************/
+						test_28_results.push_back(std::tuple_cat(std::make_tuple(i, j), speed_test(i, d, mixed_par)));
+
+						/*******************************************************************************/
+						/*           test 29 { SIMD convert + FMA transform-reduce }                   */
+						/*******************************************************************************/
+						test_29_results.push_back(std::tuple_cat(std::make_tuple(i, j), speed_test(i, d, mixed_simd)));
+
+						/*******************************************************************************/
+						/*       test 30 { parallel chunks of SIMD convert + FMA transform-reduce }    */
+						/*******************************************************************************/
+						test_30_results.push_back(std::tuple_cat(std::make_tuple(i, j), speed_test(i, d, mixed_par_simd)));
+					}
+				}
+
+				return std::make_tuple(
+					std::move(test_27_results),
+					std::move(test_28_results),
+					std::move(test_29_results),
+					std::move(test_30_results));
+			}
+			else
+				throw std::exception("Exception: Mixed-precision correcteness test results exceed the accumulation error bound.");
+		}
+	}
+}
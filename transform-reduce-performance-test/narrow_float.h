@@ -0,0 +1,127 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*      16-bit floating-point storage types (bfloat16 and IEEE half precision) for mixed-        */
+/*     precision transform-reduce: narrow storage, conversion to float on every access.          */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__FLT16_MAX__) && defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+	inline auto float_bits(float f)->std::uint32_t {
+		std::uint32_t x;
+		std::memcpy(&x, &f, sizeof(x));
+		return x;
+	}
+
+	inline auto bits_float(std::uint32_t x)->float {
+		float f;
+		std::memcpy(&f, &x, sizeof(f));
+		return f;
+	}
+
+	// the compilers' native 16-bit types are preferred, their conversions are branch-free
+	// (bit shifts for bfloat16, vcvtph2ps/vcvtps2ph for half precision); the software
+	// conversions below are the fallback where they are missing (MSVC) and for half
+	// precision without F16C, where _Float16 converts by library calls
+
+	// bfloat16: the upper half of an IEEE single, 8 exponent and 7 mantissa bits
+#if defined(__BFLT16_MAX__)
+	using bfloat16_t = __bf16;
+#else
+	struct bfloat16_t {
+		std::uint16_t bits{ 0u };
+
+		bfloat16_t() = default;
+		bfloat16_t(float f) {
+			auto x{ float_bits(f) };
+			if ((x & 0x7fffffffu) > 0x7f800000u) bits = static_cast<std::uint16_t>((x >> 16) | 0x0040u);	// quiet NaN
+			else bits = static_cast<std::uint16_t>((x + 0x7fffu + ((x >> 16) & 1u)) >> 16);			// round to nearest even
+		}
+		operator float() const { return bits_float(static_cast<std::uint32_t>(bits) << 16); }
+	};
+#endif
+
+	// IEEE 754 binary16: 5 exponent and 10 mantissa bits
+#if defined(__FLT16_MAX__) && defined(__F16C__)
+	using float16_t = _Float16;
+#else
+	struct float16_t {
+		std::uint16_t bits{ 0u };
+
+		float16_t() = default;
+		float16_t(float f) {
+			auto x{ float_bits(f) };
+			const std::uint32_t sign{ (x >> 16) & 0x8000u };
+			x &= 0x7fffffffu;
+
+			std::uint32_t h;
+			if (x > 0x7f800000u) h = 0x7e00u;				// NaN
+			else if (x >= 0x477ff000u) h = 0x7c00u;			// rounds to infinity
+			else if (x < 0x33000000u) h = 0u;				// rounds to zero
+			else if (x < 0x38800000u) {					// subnormal
+				const std::uint32_t shift{ 126u - (x >> 23) };
+				const std::uint32_t m{ (x & 0x7fffffu) | 0x800000u };
+				const std::uint32_t rem{ m & ((1u << shift) - 1u) }, half{ 1u << (shift - 1u) };
+				h = m >> shift;
+				if (rem > half || (rem == half && (h & 1u))) ++h;
+			}
+			else {								// normal, exponent rebiased from 127 to 15
+				const std::uint32_t rem{ x & 0x1fffu };
+				h = (x - 0x38000000u) >> 13;
+				if (rem > 0x1000u || (rem == 0x1000u && (h & 1u))) ++h;
+			}
+			bits = static_cast<std::uint16_t>(sign | h);
+		}
+		operator float() const {
+			const std::uint32_t sign{ static_cast<std::uint32_t>(bits & 0x8000u) << 16 };
+			const std::uint32_t exponent{ (bits >> 10) & 0x1fu }, mantissa{ bits & 0x3ffu };
+			if (exponent == 0u) {
+				const float f{ static_cast<float>(mantissa) * bits_float(0x33800000u) };	// mantissa * 2^-24
+				return bits_float(sign | float_bits(f));
+			}
+			if (exponent == 0x1fu) return bits_float(sign | 0x7f800000u | (mantissa << 13));
+			return bits_float(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+		}
+	};
+#endif
+
+	// element types the mixed-precision transform-reduce can store
+	template<typename S>
+	constexpr bool is_storage_float_v = std::is_same_v<S, float> ||
+		std::is_same_v<S, bfloat16_t> ||
+		std::is_same_v<S, float16_t>;
+
+	// stored element -> accumulator type
+	template<typename A, typename S>
+	inline auto to_accumulator(const S& x)->A {
+		if constexpr (std::is_same_v<S, float>) return static_cast<A>(x);
+#if defined(__BFLT16_MAX__)
+		// native types explicitly through single precision, compilers may fold
+		// a conversion to double into a 16-bit -> double library call
+		else if constexpr (std::is_same_v<S, bfloat16_t>) {
+			std::uint16_t bits;
+			std::memcpy(&bits, &x, sizeof(bits));
+			return static_cast<A>(bits_float(static_cast<std::uint32_t>(bits) << 16));
+		}
+#endif
+#if defined(__FLT16_MAX__) && defined(__F16C__)
+		else if constexpr (std::is_same_v<S, float16_t>) {
+			std::uint16_t bits;
+			std::memcpy(&bits, &x, sizeof(bits));
+			return static_cast<A>(_cvtsh_ss(bits));
+		}
+#endif
+		else return static_cast<A>(static_cast<float>(x));
+	}
+}
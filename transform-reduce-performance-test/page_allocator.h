@@ -0,0 +1,202 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*       Page-backed allocator for benchmark buffers: page aligned (hence cache-line aligned)    */
+/*           memory on 4 KB or 2 MB pages, optionally pre-faulted at allocation time.            */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#endif
+
+namespace {
+
+	enum class page_kind { standard, huge };
+
+	constexpr size_t cache_line_size{ 64u };
+	constexpr size_t standard_page_size{ 4096u };
+	constexpr size_t huge_page_size{ 2u * 1024u * 1024u };
+	static_assert(standard_page_size % cache_line_size == 0u, "page-backed buffers must be cache-line aligned");
+
+	constexpr auto round_up(size_t bytes, size_t granularity)->size_t {
+		return (bytes + granularity - 1u) / granularity * granularity;
+	}
+
+	// touches every standard page, so no page fault is left for the measured code
+	inline auto prefault_pages(void* p, size_t bytes)->void {
+		auto first{ static_cast<volatile char*>(p) };
+		for (size_t k{ 0u }; k < bytes; k += standard_page_size) first[k] = 0;
+	}
+
+	// maps anonymous memory backed by pages of the requested kind,
+	// returns nullptr if no memory could be mapped
+	inline auto map_pages(size_t bytes, page_kind kind, bool prefault)->void* {
+		void* p{ nullptr };
+
+#if defined(_WIN32)
+		if (kind == page_kind::huge) {
+			// large pages are always resident, so they are pre-faulted by construction;
+			// they require the SeLockMemoryPrivilege of the user running the tests
+			const size_t large_page{ GetLargePageMinimum() };
+			if (large_page != 0u)
+				p = VirtualAlloc(nullptr, round_up(bytes, large_page), MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (p != nullptr) return p;
+		}
+		p = VirtualAlloc(nullptr, round_up(bytes, standard_page_size), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		if (p != nullptr && prefault) prefault_pages(p, bytes);
+#elif defined(__linux__)
+		if (kind == page_kind::huge) {
+			const size_t length{ round_up(bytes, huge_page_size) };
+
+			// explicit hugetlbfs pages first...
+			p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (prefault ? MAP_POPULATE : 0), -1, 0);
+			if (p != MAP_FAILED) return p;
+
+			// ...then a 2 MB aligned mapping advised for transparent huge pages
+			p = mmap(nullptr, length + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (p == MAP_FAILED) return nullptr;
+			auto base{ reinterpret_cast<uintptr_t>(p) };
+			auto aligned{ round_up(base, huge_page_size) };
+			if (aligned != base) munmap(p, aligned - base);
+			if (aligned + length != base + length + huge_page_size)
+				munmap(reinterpret_cast<void*>(aligned + length), base + huge_page_size - aligned);
+			p = reinterpret_cast<void*>(aligned);
+			// only advice: huge_page_share() tells whether the kernel followed it
+			madvise(p, length, MADV_HUGEPAGE);
+			if (prefault) prefault_pages(p, length);
+			return p;
+		}
+		const size_t length{ round_up(bytes, standard_page_size) };
+		p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED) return nullptr;
+
+		// keep 4 KB pages even when transparent huge pages are enabled system-wide
+		madvise(p, length, MADV_NOHUGEPAGE);
+		if (prefault) prefault_pages(p, length);
+#else
+		(void)kind;
+		p = ::operator new(round_up(bytes, standard_page_size), std::align_val_t(standard_page_size), std::nothrow);
+		if (p != nullptr && prefault) prefault_pages(p, bytes);
+#endif
+
+		return p;
+	}
+
+	inline auto unmap_pages(void* p, size_t bytes, page_kind kind)->void {
+#if defined(_WIN32)
+		(void)bytes, (void)kind;
+		VirtualFree(p, 0u, MEM_RELEASE);
+#elif defined(__linux__)
+		munmap(p, round_up(bytes, kind == page_kind::huge ? huge_page_size : standard_page_size));
+#else
+		(void)bytes, (void)kind;
+		::operator delete(p, std::align_val_t(standard_page_size));
+#endif
+	}
+
+	// share of the buffer [p, p + bytes) actually backed by huge pages as reported by the
+	// operating system, -1 if it cannot be determined; a request for huge pages may have been
+	// served by standard pages without any error, e.g. when THP is disabled or memory is fragmented
+	inline auto huge_page_share(const void* p, size_t bytes)->double {
+		if (bytes == 0u) return 0.0;
+#if defined(_WIN32)
+		// large page allocations are all or nothing, the first page tells for the whole buffer
+		PSAPI_WORKING_SET_EX_INFORMATION info{};
+		info.VirtualAddress = const_cast<void*>(p);
+		if (!QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info)) || !info.VirtualAttributes.Valid) return -1.0;
+		return info.VirtualAttributes.LargePage ? 1.0 : 0.0;
+#elif defined(__linux__)
+		// hugetlbfs mappings report a 2 MB KernelPageSize, transparent huge pages are counted
+		// by AnonHugePages; a mapping the kernel merged with its neighbours counts by its average
+		std::ifstream smaps("/proc/self/smaps");
+		if (!smaps) return -1.0;
+		const auto first{ reinterpret_cast<uintptr_t>(p) }, last{ first + bytes };
+		uintptr_t start{ 0u }, end{ 0u };
+		size_t anon_huge{ 0u }, kernel_page{ 0u };
+		double huge{ 0.0 }, covered{ 0.0 };
+		auto account = [&]() {
+			const auto lo{ std::max(start, first) }, hi{ std::min(end, last) };
+			if (lo >= hi) return;
+			const double overlap{ static_cast<double>(hi - lo) };
+			covered += overlap;
+			if (kernel_page >= huge_page_size) huge += overlap;
+			else huge += overlap * std::min(1.0, static_cast<double>(anon_huge) / static_cast<double>(end - start));
+		};
+		std::string line;
+		while (std::getline(smaps, line)) {
+			unsigned long long s, e;
+			size_t kb;
+			if (std::sscanf(line.c_str(), "%llx-%llx", &s, &e) == 2) {
+				account();
+				start = static_cast<uintptr_t>(s);
+				end = static_cast<uintptr_t>(e);
+				anon_huge = kernel_page = 0u;
+			}
+			else if (std::sscanf(line.c_str(), "AnonHugePages: %zu kB", &kb) == 1) anon_huge = kb * 1024u;
+			else if (std::sscanf(line.c_str(), "KernelPageSize: %zu kB", &kb) == 1) kernel_page = kb * 1024u;
+		}
+		account();
+		return covered > 0.0 ? huge / covered : -1.0;
+#else
+		// plain aligned heap memory, never on huge pages
+		(void)p;
+		return 0.0;
+#endif
+	}
+
+	// standard-conforming allocator handing out page-backed memory, e.g.
+	// std::vector<double, page_allocator<double> > v(n, 0.0, page_allocator<double>(page_kind::huge));
+	template<typename T>
+	class page_allocator {
+	public:
+		using value_type = T;
+
+		static_assert(alignof(T) <= standard_page_size, "over-aligned element type");
+
+		page_allocator(page_kind kind = page_kind::standard, bool prefault = true) noexcept :
+			kind_(kind), prefault_(prefault) {}
+
+		template<typename U>
+		page_allocator(const page_allocator<U>& other) noexcept :
+			kind_(other.kind()), prefault_(other.prefault()) {}
+
+		auto allocate(size_t n)->T* {
+			void* p{ map_pages(n * sizeof(T), kind_, prefault_) };
+			if (p == nullptr) throw std::bad_alloc();
+			return static_cast<T*>(p);
+		}
+
+		auto deallocate(T* p, size_t n) noexcept->void { unmap_pages(p, n * sizeof(T), kind_); }
+
+		auto kind() const noexcept->page_kind { return kind_; }
+		auto prefault() const noexcept->bool { return prefault_; }
+
+		template<typename U>
+		friend auto operator==(const page_allocator& x, const page_allocator<U>& y) noexcept->bool {
+			return x.kind() == y.kind() && x.prefault() == y.prefault();
+		}
+		template<typename U>
+		friend auto operator!=(const page_allocator& x, const page_allocator<U>& y) noexcept->bool { return !(x == y); }
+
+	private:
+		page_kind kind_;
+		bool prefault_;
+	};
+}
@@ -0,0 +1,184 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*     Transform-reduce performance tests on buffers backed by 4 KB pages versus 2 MB pages,     */
+/*                      with the data TLB misses of every measurement.                           */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <algorithm>
+#include <execution>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <limits>
+#include <tuple>
+#include <cmath>
+
+#include "page_allocator.h"
+#include "tlb_miss_counter.h"
+#include "tester_utilities.h"
+
+namespace {
+
+	// a platform for testing the effect of the page size of the input buffers
+	//
+	// every result is { number of tests, size of data, run-time, dTLB misses (-1 if not available;
+	// counted on the calling thread for the seq tests, on every CPU for the par tests, whose thread
+	// pool is older than any counter of the calling thread),
+	// share of the input buffers backed by 2 MB pages (-1 if unknown), input buffers not entirely on
+	// 2 MB pages although requested (0 for 4 KB page tests) }
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto page_size_transform_reduce_test(
+		const std::vector<size_t>& nIter,
+		const std::vector<size_t>& szData)->std::tuple<
+		std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >,
+		std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >,
+		std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >,
+		std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >
+		> {
+		if constexpr (std::is_arithmetic_v<T> &&
+			std::is_invocable_r_v<T, BinOpReduce<T>, const T&, const T&> &&
+			std::is_invocable_r_v<T, BinOpTransform<T>, const T&, const T&>) {
+
+			using buffer = std::vector<T, page_allocator<T> >;
+
+			// tests result
+			std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> > test_21_results;
+			std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> > test_22_results;
+			std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> > test_23_results;
+			std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> > test_24_results;
+
+			// random number distribution preparation
+			std::random_device rd;
+			std::default_random_engine rng{ rd() };
+
+			// test case buffers initialization by uniform distributed random numbers
+			auto random_data = [&rng](size_t n, page_kind kind) {
+				buffer a(n, T(0), page_allocator<T>(kind)), b(n, T(0), page_allocator<T>(kind));
+				if constexpr (std::is_integral_v<T>) {
+					constexpr T lower_limit = std::numeric_limits<T>::min(), upper_limit = std::numeric_limits<T>::max();
+					std::uniform_int_distribution<T> rnd(lower_limit, upper_limit);
+					std::generate(std::begin(a), std::end(a), [&rng, &rnd]() { return rnd(rng); });
+					std::generate(std::begin(b), std::end(b), [&rng, &rnd]() { return rnd(rng); });
+				}
+				else if constexpr (std::is_floating_point_v<T>) {
+					constexpr T lower_limit = T(0), upper_limit = T(1);
+					std::uniform_real_distribution<T> rnd(lower_limit, upper_limit);
+					std::generate(std::begin(a), std::end(a), [&rng, &rnd]() { return rnd(rng); });
+					std::generate(std::begin(b), std::end(b), [&rng, &rnd]() { return rnd(rng); });
+				}
+				return std::make_pair(std::move(a), std::move(b));
+			};
+
+			// page backing of a pair of input buffers as reported by the operating system:
+			// the share on 2 MB pages and how many of them fell back to 4 KB pages
+			auto backing = [](const buffer& a, const buffer& b, page_kind requested) {
+				const double share_a{ huge_page_share(a.data(), a.size() * sizeof(T)) };
+				const double share_b{ huge_page_share(b.data(), b.size() * sizeof(T)) };
+				if (share_a < 0.0 || share_b < 0.0) return std::make_pair(-1.0, size_t(0));
+				const size_t fallbacks{ requested == page_kind::huge ? size_t(share_a < 1.0) + size_t(share_b < 1.0) : size_t(0) };
+				return std::make_pair((share_a + share_b) / 2.0, fallbacks);
+			};
+
+			// tests 21, 22 { std::transform_reduce(seq,...) }
+			auto transform_reduce_seq = [](const buffer& a, const buffer& b) {
+				return std::transform_reduce(std::execution::seq,
+					std::begin(a),
+					std::end(a),
+					std::begin(b),
+					T(0),
+					BinOpReduce<T>(),
+					BinOpTransform<T>());
+			};
+
+			// tests 23, 24 { std::transform_reduce(par,...) }
+			auto transform_reduce_par = [](const buffer& a, const buffer& b) {
+				return std::transform_reduce(std::execution::par,
+					std::begin(a),
+					std::end(a),
+					std::begin(b),
+					T(0),
+					BinOpReduce<T>(),
+					BinOpTransform<T>());
+			};
+
+			// correctness of results validation: the same data on either page size
+			auto validation = [&, n = szData[0u]]()->bool {
+				auto standard{ random_data(n, page_kind::standard) };
+				buffer ha(std::begin(standard.first), std::end(standard.first), page_allocator<T>(page_kind::huge));
+				buffer hb(std::begin(standard.second), std::end(standard.second), page_allocator<T>(page_kind::huge));
+
+				auto reference{ transform_reduce_seq(standard.first, standard.second) };
+				return transform_reduce_seq(ha, hb) == reference &&
+					same_result(transform_reduce_par(standard.first, standard.second), reference, n) &&
+					same_result(transform_reduce_par(ha, hb), reference, n);
+			};
+			if (validation()) {
+
+				tlb_miss_counter thread_counter(tlb_miss_scope::calling_thread), cpu_counter(tlb_miss_scope::all_cpus);
+
+				// run-time and dTLB misses of i repetitions of f
+				auto speed_test = [](size_t i, tlb_miss_counter& counter, auto&& f) {
+					counter.start();
+					auto Δt{ timed_repetitions(i, f) };
+					return std::make_pair(Δt, counter.stop());
+				};
+
+				// test procedure...
+				for (auto i : nIter) {
+					for (auto j : szData) {
+
+						// test cases data structures
+						auto standard{ random_data(j, page_kind::standard) };
+						buffer ha(std::begin(standard.first), std::end(standard.first), page_allocator<T>(page_kind::huge));
+						buffer hb(std::begin(standard.second), std::end(standard.second), page_allocator<T>(page_kind::huge));
+						const auto& sa{ standard.first };
+						const auto& sb{ standard.second };
+						auto [share_s, fallbacks_s] = backing(sa, sb, page_kind::standard);
+						auto [share_h, fallbacks_h] = backing(ha, hb, page_kind::huge);
+
+						/*******************************************************************************/
+						/*            test 21 { std::transform_reduce(seq,...), 4 KB pages }           */
+						/*******************************************************************************/
+						auto [Δt21, misses21] = speed_test(i, thread_counter, [&]() { return transform_reduce_seq(sa, sb); });
+						test_21_results.push_back(std::make_tuple(i, j, Δt21, misses21, share_s, fallbacks_s));
+
+						/*******************************************************************************/
+						/*            test 22 { std::transform_reduce(seq,...), 2 MB pages }           */
+						/*******************************************************************************/
+						auto [Δt22, misses22] = speed_test(i, thread_counter, [&]() { return transform_reduce_seq(ha, hb); });
+						test_22_results.push_back(std::make_tuple(i, j, Δt22, misses22, share_h, fallbacks_h));
+
+						/*******************************************************************************/
+						/*            test 23 { std::transform_reduce(par,...), 4 KB pages }           */
+						/*******************************************************************************/
+						auto [Δt23, misses23] = speed_test(i, cpu_counter, [&]() { return transform_reduce_par(sa, sb); });
+						test_23_results.push_back(std::make_tuple(i, j, Δt23, misses23, share_s, fallbacks_s));
+
+						/*******************************************************************************/
+						/*            test 24 { std::transform_reduce(par,...), 2 MB pages }           */
+						/*******************************************************************************/
+						auto [Δt24, misses24] = speed_test(i, cpu_counter, [&]() { return transform_reduce_par(ha, hb); });
+						test_24_results.push_back(std::make_tuple(i, j, Δt24, misses24, share_h, fallbacks_h));
+					}
+				}
+
+				return std::make_tuple(
+					std::move(test_21_results),
+					std::move(test_22_results),
+					std::move(test_23_results),
+					std::move(test_24_results));
+			}
+			else
+				throw std::exception("Exception: Page size correcteness test results don't have same values.");
+		}
+	}
+}
@@ -0,0 +1,455 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*      Hand-vectorized transform-reduce kernels (AVX2 / AVX-512) with portable scalar tails.    */
+/*   A kernel is vectorized only when the instruction set is compiled in, the host CPU has it   */
+/*   and both binary operations have a SIMD counterpart; otherwise the scalar loop does it all.  */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <type_traits>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "cpu_features.h"
+
+#if defined(SIMD_KERNELS_AVX512) || defined(SIMD_KERNELS_AVX2)
+#include <immintrin.h>
+#endif
+
+#include "wide_integer.h"
+#include "narrow_float.h"
+
+namespace {
+
+	// identity element of the reduction, i.e. what a masked-off lane contributes
+	template<typename T, template<typename> typename BinOpReduce>
+	constexpr auto reduction_identity()->T {
+		if constexpr (std::is_same_v<BinOpReduce<T>, std::multiplies<T> >) return T(1);
+		else {
+			static_assert(std::is_same_v<BinOpReduce<T>, std::plus<T> >, "reduction without a known identity element");
+			return T(0);
+		}
+	}
+
+	// SIMD counterparts of the standard binary function objects
+	template<typename BinOp>
+	struct simd_op { static constexpr bool available = false; };
+
+#if defined(SIMD_KERNELS_AVX512) || defined(SIMD_KERNELS_AVX2)
+	template<>
+	struct simd_op<std::plus<double> > {
+		static constexpr bool available = true;
+		static auto apply(__m256d x, __m256d y)->__m256d { return _mm256_add_pd(x, y); }
+#if defined(SIMD_KERNELS_AVX512)
+		static auto apply(__m512d x, __m512d y)->__m512d { return _mm512_add_pd(x, y); }
+#endif
+	};
+
+	template<>
+	struct simd_op<std::multiplies<double> > {
+		static constexpr bool available = true;
+		static auto apply(__m256d x, __m256d y)->__m256d { return _mm256_mul_pd(x, y); }
+#if defined(SIMD_KERNELS_AVX512)
+		static auto apply(__m512d x, __m512d y)->__m512d { return _mm512_mul_pd(x, y); }
+#endif
+	};
+#endif
+
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	constexpr bool simd_kernel_available_v = std::is_same_v<T, double> &&
+		simd_op<BinOpReduce<T> >::available &&
+		simd_op<BinOpTransform<T> >::available;
+
+	// horizontal reduction of the SIMD accumulator lanes
+	template<typename T, template<typename> typename BinOpReduce, size_t N>
+	auto horizontal_reduce(const T(&lanes)[N], T acc)->T {
+		BinOpReduce<T> reduce;
+		for (auto k{ 0u }; k < N; ++k) acc = reduce(acc, lanes[k]);
+		return acc;
+	}
+
+	// whether predicated_transform_reduce runs a vector loop on this host
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto predicated_kernel_vectorized()->bool {
+		[[maybe_unused]] constexpr bool vector_form{ simd_kernel_available_v<T, BinOpReduce, BinOpTransform> };
+#if defined(SIMD_KERNELS_AVX512) && defined(SIMD_KERNELS_AVX2)
+		return vector_form && (host_cpu.avx512f || host_cpu.avx2);
+#elif defined(SIMD_KERNELS_AVX512)
+		return vector_form && host_cpu.avx512f;
+#elif defined(SIMD_KERNELS_AVX2)
+		return vector_form && host_cpu.avx2;
+#else
+		return false;
+#endif
+	}
+
+	// whether gather_transform_reduce runs a vector loop on this host
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto gather_kernel_vectorized()->bool {
+		return sizeof(size_t) == 8u && predicated_kernel_vectorized<T, BinOpReduce, BinOpTransform>();
+	}
+
+	// branchless predicated transform-reduce: every element is transformed,
+	// masked-off lanes are replaced by the reduction identity
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto predicated_transform_reduce(const T* a, const T* b, const bool* mask, size_t n)->T {
+		constexpr T identity{ reduction_identity<T, BinOpReduce>() };
+		BinOpReduce<T> reduce;
+		BinOpTransform<T> transform;
+		T acc{ identity };
+		size_t k{ 0u };
+
+		if constexpr (simd_kernel_available_v<T, BinOpReduce, BinOpTransform>) {
+#if defined(SIMD_KERNELS_AVX512)
+			if (host_cpu.avx512f) {
+				using R = simd_op<BinOpReduce<T> >;
+				using X = simd_op<BinOpTransform<T> >;
+				const __m512d vid{ _mm512_set1_pd(identity) };
+				__m512d vacc{ vid };
+				for (; k + 8u <= n; k += 8u) {
+					long long bits;
+					std::memcpy(&bits, mask + k, 8u);
+					const __mmask8 m{ _mm512_test_epi64_mask(_mm512_cvtepu8_epi64(_mm_cvtsi64_si128(bits)), _mm512_set1_epi64(-1)) };
+					const __m512d t{ X::apply(_mm512_loadu_pd(a + k), _mm512_loadu_pd(b + k)) };
+					vacc = R::apply(vacc, _mm512_mask_mov_pd(vid, m, t));
+				}
+				alignas(64) double lanes[8];
+				_mm512_store_pd(lanes, vacc);
+				acc = horizontal_reduce<T, BinOpReduce>(lanes, acc);
+			}
+#endif
+#if defined(SIMD_KERNELS_AVX2)
+			if (host_cpu.avx2) {
+				using R = simd_op<BinOpReduce<T> >;
+				using X = simd_op<BinOpTransform<T> >;
+				const __m256d vid{ _mm256_set1_pd(identity) };
+				__m256d vacc{ vid };
+				for (; k + 4u <= n; k += 4u) {
+					int bits;
+					std::memcpy(&bits, mask + k, 4u);
+					const __m256i m{ _mm256_cmpgt_epi64(_mm256_cvtepu8_epi64(_mm_cvtsi32_si128(bits)), _mm256_setzero_si256()) };
+					const __m256d t{ X::apply(_mm256_loadu_pd(a + k), _mm256_loadu_pd(b + k)) };
+					vacc = R::apply(vacc, _mm256_blendv_pd(vid, t, _mm256_castsi256_pd(m)));
+				}
+				alignas(32) double lanes[4];
+				_mm256_store_pd(lanes, vacc);
+				acc = horizontal_reduce<T, BinOpReduce>(lanes, acc);
+			}
+#endif
+		}
+
+		for (; k < n; ++k) acc = reduce(acc, mask[k] ? transform(a[k], b[k]) : identity);
+		return acc;
+	}
+
+	// gather transform-reduce over an index list
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto gather_transform_reduce(const T* a, const T* b, const size_t* idx, size_t m)->T {
+		constexpr T identity{ reduction_identity<T, BinOpReduce>() };
+		BinOpReduce<T> reduce;
+		BinOpTransform<T> transform;
+		T acc{ identity };
+		size_t k{ 0u };
+
+		if constexpr (simd_kernel_available_v<T, BinOpReduce, BinOpTransform> && sizeof(size_t) == 8u) {
+#if defined(SIMD_KERNELS_AVX512)
+			if (host_cpu.avx512f) {
+				using R = simd_op<BinOpReduce<T> >;
+				using X = simd_op<BinOpTransform<T> >;
+				__m512d vacc{ _mm512_set1_pd(identity) };
+				for (; k + 8u <= m; k += 8u) {
+					const __m512i vi{ _mm512_loadu_si512(idx + k) };
+					vacc = R::apply(vacc, X::apply(_mm512_i64gather_pd(vi, a, 8), _mm512_i64gather_pd(vi, b, 8)));
+				}
+				alignas(64) double lanes[8];
+				_mm512_store_pd(lanes, vacc);
+				acc = horizontal_reduce<T, BinOpReduce>(lanes, acc);
+			}
+#endif
+#if defined(SIMD_KERNELS_AVX2)
+			if (host_cpu.avx2) {
+				using R = simd_op<BinOpReduce<T> >;
+				using X = simd_op<BinOpTransform<T> >;
+				__m256d vacc{ _mm256_set1_pd(identity) };
+				for (; k + 4u <= m; k += 4u) {
+					const __m256i vi{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + k)) };
+					vacc = R::apply(vacc, X::apply(_mm256_i64gather_pd(a, vi, 8), _mm256_i64gather_pd(b, vi, 8)));
+				}
+				alignas(32) double lanes[4];
+				_mm256_store_pd(lanes, vacc);
+				acc = horizontal_reduce<T, BinOpReduce>(lanes, acc);
+			}
+#endif
+		}
+
+		for (; k < m; ++k) acc = reduce(acc, transform(a[idx[k]], b[idx[k]]));
+		return acc;
+	}
+
+	// stream compaction of the selected elements into dense buffers,
+	// returns the number of selected elements
+	template<typename T>
+	auto compact(const T* a, const T* b, const bool* mask, size_t n, T* ca, T* cb)->size_t {
+		size_t m{ 0u }, k{ 0u };
+
+#if defined(SIMD_KERNELS_AVX512)
+		if constexpr (std::is_same_v<T, double>) {
+			if (host_cpu.avx512f) {
+				for (; k + 8u <= n; k += 8u) {
+					long long bits;
+					std::memcpy(&bits, mask + k, 8u);
+					const __mmask8 s{ _mm512_test_epi64_mask(_mm512_cvtepu8_epi64(_mm_cvtsi64_si128(bits)), _mm512_set1_epi64(-1)) };
+					_mm512_mask_compressstoreu_pd(ca + m, s, _mm512_loadu_pd(a + k));
+					_mm512_mask_compressstoreu_pd(cb + m, s, _mm512_loadu_pd(b + k));
+					m += static_cast<size_t>(_mm_popcnt_u32(s));
+				}
+			}
+		}
+#endif
+
+		// branchless: always store, advance the output cursor by the predicate
+		for (; k < n; ++k) {
+			ca[m] = a[k];
+			cb[m] = b[k];
+			m += static_cast<size_t>(mask[k]);
+		}
+		return m;
+	}
+
+#if defined(SIMD_KERNELS_AVX512)
+	// adds the sign-extended 64-bit lanes of v to the 128-bit lane accumulators hi:lo,
+	// the carry out of the low half is found by an unsigned compare
+	inline auto add_wide(__m512i& lo, __m512i& hi, __m512i v)->void {
+		const __m512i sum{ _mm512_add_epi64(lo, v) };
+		hi = _mm512_add_epi64(hi, _mm512_srai_epi64(v, 63));
+		hi = _mm512_mask_add_epi64(hi, _mm512_cmplt_epu64_mask(sum, lo), hi, _mm512_set1_epi64(1));
+		lo = sum;
+	}
+#endif
+
+#if defined(SIMD_KERNELS_AVX2)
+	// AVX2 has no unsigned 64-bit compare: the sign bits are flipped and the
+	// lanes compared signed, the all-ones carry mask is subtracted from hi
+	inline auto add_wide(__m256i& lo, __m256i& hi, __m256i v)->void {
+		const __m256i flip{ _mm256_set1_epi64x(std::numeric_limits<std::int64_t>::min()) };
+		const __m256i sum{ _mm256_add_epi64(lo, v) };
+		const __m256i carry{ _mm256_cmpgt_epi64(_mm256_xor_si256(lo, flip), _mm256_xor_si256(sum, flip)) };
+		hi = _mm256_sub_epi64(_mm256_add_epi64(hi, _mm256_cmpgt_epi64(_mm256_setzero_si256(), v)), carry);
+		lo = sum;
+	}
+#endif
+
+	// whether widening_transform_reduce runs a vector loop on this host
+	template<typename T, template<typename> typename BinOpTransform>
+	auto widening_kernel_vectorized()->bool {
+		[[maybe_unused]] constexpr bool vector_form{ std::is_same_v<T, std::int32_t> ||
+			(std::is_same_v<T, std::int64_t> && std::is_same_v<BinOpTransform<T>, std::plus<T> >) };
+#if defined(SIMD_KERNELS_AVX512) && defined(SIMD_KERNELS_AVX2)
+		return vector_form && (host_cpu.avx512f || host_cpu.avx2);
+#elif defined(SIMD_KERNELS_AVX512)
+		return vector_form && host_cpu.avx512f;
+#elif defined(SIMD_KERNELS_AVX2)
+		return vector_form && host_cpu.avx2;
+#else
+		return false;
+#endif
+	}
+
+	// widening transform-reduce: int32 elements are sign-extended into 64-bit
+	// lanes and transformed/accumulated there (vpmovsxdq + vpmuldq/vpaddq + vpaddq),
+	// int64 sums are accumulated in 128-bit lanes split into a low and a high half;
+	// int64 products have no vector form and are accumulated by the scalar loop
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto widening_transform_reduce(const T* a, const T* b, size_t n)->widened_t<T> {
+		static_assert(std::is_same_v<BinOpReduce<T>, std::plus<T> >, "widened reductions accumulate by addition");
+		[[maybe_unused]] constexpr bool multiply{ std::is_same_v<BinOpTransform<T>, std::multiplies<T> > };
+		widened_transform<T, BinOpTransform> transform;
+		widened_t<T> acc{ 0 };
+		size_t k{ 0u };
+
+		if constexpr (std::is_same_v<T, std::int32_t>) {
+#if defined(SIMD_KERNELS_AVX512)
+			if (host_cpu.avx512f) {
+				__m512i vacc{ _mm512_setzero_si512() };
+				for (; k + 8u <= n; k += 8u) {
+					const __m512i x{ _mm512_cvtepi32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k))) };
+					const __m512i y{ _mm512_cvtepi32_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k))) };
+					if constexpr (multiply) vacc = _mm512_add_epi64(vacc, _mm512_mul_epi32(x, y));
+					else vacc = _mm512_add_epi64(vacc, _mm512_add_epi64(x, y));
+				}
+				acc += _mm512_reduce_add_epi64(vacc);
+			}
+#endif
+#if defined(SIMD_KERNELS_AVX2)
+			if (host_cpu.avx2) {
+				__m256i vacc{ _mm256_setzero_si256() };
+				for (; k + 4u <= n; k += 4u) {
+					const __m256i x{ _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + k))) };
+					const __m256i y{ _mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + k))) };
+					if constexpr (multiply) vacc = _mm256_add_epi64(vacc, _mm256_mul_epi32(x, y));
+					else vacc = _mm256_add_epi64(vacc, _mm256_add_epi64(x, y));
+				}
+				alignas(32) std::int64_t lanes[4];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), vacc);
+				acc = horizontal_reduce<std::int64_t, std::plus>(lanes, acc);
+			}
+#endif
+		}
+		else if constexpr (std::is_same_v<T, std::int64_t> && !multiply) {
+#if defined(SIMD_KERNELS_AVX512)
+			if (host_cpu.avx512f) {
+				__m512i lo{ _mm512_setzero_si512() }, hi{ _mm512_setzero_si512() };
+				for (; k + 8u <= n; k += 8u) {
+					add_wide(lo, hi, _mm512_loadu_si512(a + k));
+					add_wide(lo, hi, _mm512_loadu_si512(b + k));
+				}
+				alignas(64) std::uint64_t lanes_lo[8];
+				alignas(64) std::int64_t lanes_hi[8];
+				_mm512_store_si512(lanes_lo, lo);
+				_mm512_store_si512(lanes_hi, hi);
+				for (auto l{ 0u }; l < 8u; ++l) acc = acc + make_int128(lanes_hi[l], lanes_lo[l]);
+			}
+#endif
+#if defined(SIMD_KERNELS_AVX2)
+			if (host_cpu.avx2) {
+				__m256i lo{ _mm256_setzero_si256() }, hi{ _mm256_setzero_si256() };
+				for (; k + 4u <= n; k += 4u) {
+					add_wide(lo, hi, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + k)));
+					add_wide(lo, hi, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + k)));
+				}
+				alignas(32) std::uint64_t lanes_lo[4];
+				alignas(32) std::int64_t lanes_hi[4];
+				_mm256_store_si256(reinterpret_cast<__m256i*>(lanes_lo), lo);
+				_mm256_store_si256(reinterpret_cast<__m256i*>(lanes_hi), hi);
+				for (auto l{ 0u }; l < 4u; ++l) acc = acc + make_int128(lanes_hi[l], lanes_lo[l]);
+			}
+#endif
+		}
+
+		for (; k < n; ++k) acc = acc + transform(a[k], b[k]);
+		return acc;
+	}
+
+#if defined(SIMD_KERNELS_AVX2)
+	// fused multiply-add where the instruction set is compiled in, the callers check the host for it
+	inline auto fmadd(__m256 x, __m256 y, __m256 z)->__m256 {
+#if defined(SIMD_KERNELS_FMA)
+		return _mm256_fmadd_ps(x, y, z);
+#else
+		return _mm256_add_ps(_mm256_mul_ps(x, y), z);
+#endif
+	}
+
+	inline auto fmadd(__m256d x, __m256d y, __m256d z)->__m256d {
+#if defined(SIMD_KERNELS_FMA)
+		return _mm256_fmadd_pd(x, y, z);
+#else
+		return _mm256_add_pd(_mm256_mul_pd(x, y), z);
+#endif
+	}
+#endif
+
+	// stored element types the SIMD kernels can convert to single precision
+	template<typename S>
+	constexpr bool simd_convertible_v = std::is_same_v<S, float> || std::is_same_v<S, bfloat16_t>
+#if defined(SIMD_KERNELS_F16C)
+		|| std::is_same_v<S, float16_t>
+#endif
+		;
+
+#if defined(SIMD_KERNELS_AVX2)
+	// loads 8 stored elements converted to single precision
+	template<typename S>
+	inline auto load_ps(const S* p)->__m256 {
+		if constexpr (std::is_same_v<S, float>) return _mm256_loadu_ps(p);
+		else if constexpr (std::is_same_v<S, bfloat16_t>)
+			return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))), 16));
+#if defined(SIMD_KERNELS_F16C)
+		else return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+#endif
+	}
+#endif
+
+	// whether mixed_precision_transform_reduce runs a vector loop on this host
+	template<typename S, typename A, template<typename> typename BinOpTransform>
+	auto mixed_precision_kernel_vectorized()->bool {
+		[[maybe_unused]] constexpr bool vector_form{ simd_convertible_v<S> && (std::is_same_v<A, float> || std::is_same_v<A, double>) };
+		[[maybe_unused]] constexpr bool multiply{ std::is_same_v<BinOpTransform<A>, std::multiplies<A> > };
+#if defined(SIMD_KERNELS_AVX2)
+		return vector_form && host_cpu.avx2 && (host_cpu.fma || !multiply) && (host_cpu.f16c || !std::is_same_v<S, float16_t>);
+#else
+		return false;
+#endif
+	}
+
+	// mixed-precision transform-reduce: elements stored as S are converted to the
+	// accumulator type A, transformed and reduced in A (convert + FMA for dot products)
+	template<typename S, typename A,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto mixed_precision_transform_reduce(const S* a, const S* b, size_t n)->A {
+		static_assert(std::is_same_v<BinOpReduce<A>, std::plus<A> >, "mixed-precision reductions accumulate by addition");
+		static_assert(std::is_same_v<BinOpTransform<A>, std::plus<A> > || std::is_same_v<BinOpTransform<A>, std::multiplies<A> >,
+			"transformation without a mixed-precision SIMD form");
+		[[maybe_unused]] constexpr bool multiply{ std::is_same_v<BinOpTransform<A>, std::multiplies<A> > };
+		BinOpTransform<A> transform;
+		A acc{ 0 };
+		size_t k{ 0u };
+
+#if defined(SIMD_KERNELS_AVX2)
+		if (mixed_precision_kernel_vectorized<S, A, BinOpTransform>()) {
+			if constexpr (simd_convertible_v<S> && std::is_same_v<A, float>) {
+				__m256 vacc{ _mm256_setzero_ps() };
+				for (; k + 8u <= n; k += 8u) {
+					const __m256 x{ load_ps(a + k) }, y{ load_ps(b + k) };
+					if constexpr (multiply) vacc = fmadd(x, y, vacc);
+					else vacc = _mm256_add_ps(vacc, _mm256_add_ps(x, y));
+				}
+				alignas(32) float lanes[8];
+				_mm256_store_ps(lanes, vacc);
+				acc = horizontal_reduce<float, std::plus>(lanes, acc);
+			}
+			else if constexpr (simd_convertible_v<S> && std::is_same_v<A, double>) {
+				__m256d vacc_lo{ _mm256_setzero_pd() }, vacc_hi{ _mm256_setzero_pd() };
+				for (; k + 8u <= n; k += 8u) {
+					const __m256 x{ load_ps(a + k) }, y{ load_ps(b + k) };
+					const __m256d x_lo{ _mm256_cvtps_pd(_mm256_castps256_ps128(x)) }, x_hi{ _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1)) };
+					const __m256d y_lo{ _mm256_cvtps_pd(_mm256_castps256_ps128(y)) }, y_hi{ _mm256_cvtps_pd(_mm256_extractf128_ps(y, 1)) };
+					if constexpr (multiply) {
+						vacc_lo = fmadd(x_lo, y_lo, vacc_lo);
+						vacc_hi = fmadd(x_hi, y_hi, vacc_hi);
+					}
+					else {
+						vacc_lo = _mm256_add_pd(vacc_lo, _mm256_add_pd(x_lo, y_lo));
+						vacc_hi = _mm256_add_pd(vacc_hi, _mm256_add_pd(x_hi, y_hi));
+					}
+				}
+				alignas(32) double lanes[4];
+				_mm256_store_pd(lanes, _mm256_add_pd(vacc_lo, vacc_hi));
+				acc = horizontal_reduce<double, std::plus>(lanes, acc);
+			}
+		}
+#endif
+
+		for (; k < n; ++k) acc = acc + transform(to_accumulator<A>(a[k]), to_accumulator<A>(b[k]));
+		return acc;
+	}
+}
@@ -5,6 +5,11 @@
 
 #include "addition_addition_test.h"
 #include "multiplication_addition_test.h"
+#include "masked_gather_tester.h"
+#include "widened_integer_tester.h"
+#include "page_size_tester.h"
+#include "traced_tester.h"
+#include "mixed_precision_tester.h"
 #include "test_display.h"
 
 auto main() -> int
@@ -20,6 +25,15 @@ auto main() -> int
 		// data size in each test
 		std::vector<size_t> szData{ 100u, 1000u, 10000u, 100000u, 1000000u };
 
+		// data size in the page size tests, where the buffers outgrow the dTLB reach of 4 KB pages
+		std::vector<size_t> szPageData{ 100000u, 1000000u, 10000000u };
+
+		// number of chunks per hardware thread in the traced tests
+		std::vector<size_t> chunksPerThread{ 1u, 4u, 16u };
+
+		// fraction of the data selected by the filter predicate / index list
+		std::vector<double> selectivity{ 0.01, 0.05, 0.1, 0.25, 0.5, 0.75, 0.9, 1.0 };
+
 		/*******************************************************************************/
 		/*     data type: double / transformation: addition / reduction: addition      */
 		/*******************************************************************************/
@@ -32,6 +46,69 @@ auto main() -> int
 		auto double_multiplication_addition_tests_results{ multiplication_addition_test<double>(nIter, szData) };
 		test_results_display<double>("double", "multiplication", "addition", double_multiplication_addition_tests_results);
 
+		/*******************************************************************************/
+		/*    data type: double / masked and gathered transform-reduce tests           */
+		/*******************************************************************************/
+		auto double_addition_addition_masked_gather_tests_results{ masked_gather_transform_reduce_test<double, std::plus, std::plus>(nIter, szData, selectivity) };
+		masked_gather_test_results_display<double, std::plus, std::plus>("double", "addition", "addition", double_addition_addition_masked_gather_tests_results);
+
+		auto double_multiplication_addition_masked_gather_tests_results{ masked_gather_transform_reduce_test<double, std::plus, std::multiplies>(nIter, szData, selectivity) };
+		masked_gather_test_results_display<double, std::plus, std::multiplies>("double", "multiplication", "addition", double_multiplication_addition_masked_gather_tests_results);
+
+		/*******************************************************************************/
+		/*  data type: int32/int64 / accumulated in int64/int128 / widened tests       */
+		/*******************************************************************************/
+		auto int32_addition_addition_widened_tests_results{ widened_transform_reduce_test<std::int32_t, std::plus, std::plus>(nIter, szData) };
+		widened_test_results_display<std::int32_t, std::plus>("int32", "int64", "addition", "addition", int32_addition_addition_widened_tests_results);
+
+		auto int32_multiplication_addition_widened_tests_results{ widened_transform_reduce_test<std::int32_t, std::plus, std::multiplies>(nIter, szData) };
+		widened_test_results_display<std::int32_t, std::multiplies>("int32", "int64", "multiplication", "addition", int32_multiplication_addition_widened_tests_results);
+
+		auto int64_addition_addition_widened_tests_results{ widened_transform_reduce_test<std::int64_t, std::plus, std::plus>(nIter, szData) };
+		widened_test_results_display<std::int64_t, std::plus>("int64", "int128", "addition", "addition", int64_addition_addition_widened_tests_results);
+
+		auto int64_multiplication_addition_widened_tests_results{ widened_transform_reduce_test<std::int64_t, std::plus, std::multiplies>(nIter, szData) };
+		widened_test_results_display<std::int64_t, std::multiplies>("int64", "int128", "multiplication", "addition", int64_multiplication_addition_widened_tests_results);
+
+		/*******************************************************************************/
+		/*        data type: double / 4 KB pages versus 2 MB pages tests               */
+		/*******************************************************************************/
+		auto double_addition_addition_page_size_tests_results{ page_size_transform_reduce_test<double, std::plus, std::plus>(nIter, szPageData) };
+		page_size_test_results_display<double>("double", "addition", "addition", double_addition_addition_page_size_tests_results);
+
+		auto double_multiplication_addition_page_size_tests_results{ page_size_transform_reduce_test<double, std::plus, std::multiplies>(nIter, szPageData) };
+		page_size_test_results_display<double>("double", "multiplication", "addition", double_multiplication_addition_page_size_tests_results);
+
+		/*******************************************************************************/
+		/*          data type: double / traced parallel chunks tests                   */
+		/*******************************************************************************/
+		auto double_addition_addition_traced_tests_results{ traced_transform_reduce_test<double, std::plus, std::plus>(nIter, szData, chunksPerThread) };
+		traced_test_results_display<double>("double", "addition", "addition", double_addition_addition_traced_tests_results);
+
+		auto double_multiplication_addition_traced_tests_results{ traced_transform_reduce_test<double, std::plus, std::multiplies>(nIter, szData, chunksPerThread) };
+		traced_test_results_display<double>("double", "multiplication", "addition", double_multiplication_addition_traced_tests_results);
+
+		/*******************************************************************************/
+		/*  storage: float/bfloat16/float16 / accumulated in float/double / mixed tests */
+		/*******************************************************************************/
+		auto float_float_multiplication_addition_mixed_tests_results{ mixed_precision_transform_reduce_test<float, float, std::plus, std::multiplies>(nIter, szData) };
+		mixed_precision_test_results_display<float, float, std::multiplies>("float", "float", "multiplication", "addition", float_float_multiplication_addition_mixed_tests_results);
+
+		auto float_double_multiplication_addition_mixed_tests_results{ mixed_precision_transform_reduce_test<float, double, std::plus, std::multiplies>(nIter, szData) };
+		mixed_precision_test_results_display<float, double, std::multiplies>("float", "double", "multiplication", "addition", float_double_multiplication_addition_mixed_tests_results);
+
+		auto bfloat16_float_multiplication_addition_mixed_tests_results{ mixed_precision_transform_reduce_test<bfloat16_t, float, std::plus, std::multiplies>(nIter, szData) };
+		mixed_precision_test_results_display<bfloat16_t, float, std::multiplies>("bfloat16", "float", "multiplication", "addition", bfloat16_float_multiplication_addition_mixed_tests_results);
+
+		auto bfloat16_double_multiplication_addition_mixed_tests_results{ mixed_precision_transform_reduce_test<bfloat16_t, double, std::plus, std::multiplies>(nIter, szData) };
+		mixed_precision_test_results_display<bfloat16_t, double, std::multiplies>("bfloat16", "double", "multiplication", "addition", bfloat16_double_multiplication_addition_mixed_tests_results);
+
+		auto float16_float_multiplication_addition_mixed_tests_results{ mixed_precision_transform_reduce_test<float16_t, float, std::plus, std::multiplies>(nIter, szData) };
+		mixed_precision_test_results_display<float16_t, float, std::multiplies>("float16", "float", "multiplication", "addition", float16_float_multiplication_addition_mixed_tests_results);
+
+		auto float16_double_multiplication_addition_mixed_tests_results{ mixed_precision_transform_reduce_test<float16_t, double, std::plus, std::multiplies>(nIter, szData) };
+		mixed_precision_test_results_display<float16_t, double, std::multiplies>("float16", "double", "multiplication", "addition", float16_double_multiplication_addition_mixed_tests_results);
+
 		return EXIT_SUCCESS;
 	}
 	catch (const std::exception& xxx) {
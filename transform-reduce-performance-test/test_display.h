@@ -1,6 +1,7 @@
 ﻿
 #pragma once
 
+#include <algorithm>
 #include <utility>
 #include <iomanip>
 #include <string>
@@ -8,6 +9,9 @@
 #include <vector>
 #include <tuple>
 
+#include "simd_kernels.h"
+#include "chunk_tracer.h"
+
 namespace {
 
 	// display
@@ -150,4 +154,325 @@ namespace {
 		
 		ofs.close();
 	}
+
+	// masked / gather display
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto masked_gather_test_results_display(const std::string_view& data_type,
+		const std::string_view& transform_op,
+		const std::string_view& reduce_op,
+		const std::tuple<
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double> >
+		>& test_results)->void {
+
+		std::ofstream ofs;
+		std::string filename{ data_type };
+		filename += std::string("_") + std::string(transform_op);
+		filename += std::string("_") + std::string(reduce_op);
+		filename += std::string("_masked_gather_tests_results.txt");
+		ofs.open(filename, std::ios::out);
+		if (!ofs) throw std::exception("Exception: Cannot open output file.");
+
+		ofs << "\n\t" << data_type << " - " << transform_op << " - " << reduce_op << " masked/gather test results:\n";
+
+		auto display = [&ofs, &data_type, &transform_op, &reduce_op](
+			const std::vector<std::tuple<size_t, size_t, double, double> >& results,
+			const std::string_view& implementation) {
+			ofs << std::endl
+				<< "\tstd::valarray<" << data_type << "> - transformation: " << transform_op << " - reduction: " << reduce_op
+				<< " - implemented by " << implementation << ":"
+				<< "\n\tnumber of tests\t\tsize of data\t\tselectivity\t\trun-time"
+				<< "\n\t---------------\t\t------------\t\t-----------\t\t--------";
+			for (auto& test_i : results) {
+				ofs << "\n\t"
+					<< std::setprecision(9) << std::fixed << std::get<0u>(test_i) << "\t\t\t"
+					<< std::get<1u>(test_i) << "\t\t\t"
+					<< std::setprecision(2) << std::get<2u>(test_i) << "\t\t\t"
+					<< std::setprecision(9) << std::get<3u>(test_i);
+			}
+			ofs << std::endl;
+		};
+
+		// the kernels of tests 10, 13 and 15 fall back to scalar loops when the build or the host lacks the ISA
+		const std::string predicated_kind{ predicated_kernel_vectorized<T, BinOpReduce, BinOpTransform>() ? "SIMD" : "scalar" };
+		const std::string gather_kind{ gather_kernel_vectorized<T, BinOpReduce, BinOpTransform>() ? "SIMD" : "scalar" };
+
+		// tests 9-15 display
+		display(std::get<0u>(test_results), "std::valarray<T>::operator[](std::valarray<bool>) and std::transform_reduce(std::execution::seq, ...)");
+		display(std::get<1u>(test_results), "branchless predicated " + predicated_kind + " transform-reduce");
+		display(std::get<2u>(test_results), "compaction and dense std::transform_reduce(std::execution::seq, ...)");
+		display(std::get<3u>(test_results), "std::valarray<T>::operator[](std::valarray<size_t>) and std::transform_reduce(std::execution::seq, ...), ascending indices");
+		display(std::get<4u>(test_results), gather_kind + " gather transform-reduce, ascending indices");
+		display(std::get<5u>(test_results), "std::valarray<T>::operator[](std::valarray<size_t>) and std::transform_reduce(std::execution::seq, ...), shuffled indices");
+		display(std::get<6u>(test_results), gather_kind + " gather transform-reduce, shuffled indices");
+
+		// compaction vs. predication crossover: the largest selectivity s such that
+		// compaction (test 11) beats predication (test 10) at every selectivity up to s
+		ofs << std::endl
+			<< "\tcompaction vs. predication crossover:"
+			<< "\n\tnumber of tests\t\tsize of data\t\tcompaction faster up to selectivity"
+			<< "\n\t---------------\t\t------------\t\t-----------------------------------";
+		const auto& predicated{ std::get<1u>(test_results) };
+		const auto& compacted{ std::get<2u>(test_results) };
+		for (size_t k{ 0u }; k < predicated.size();) {
+			auto i{ std::get<0u>(predicated[k]) }, j{ std::get<1u>(predicated[k]) };
+			std::vector<std::pair<double, bool> > wins;
+			for (; k < predicated.size() && std::get<0u>(predicated[k]) == i && std::get<1u>(predicated[k]) == j; ++k)
+				wins.emplace_back(std::get<2u>(predicated[k]), std::get<3u>(compacted[k]) < std::get<3u>(predicated[k]));
+			std::sort(std::begin(wins), std::end(wins));
+			double crossover{ -1.0 };
+			for (auto& [selectivity, compaction_faster] : wins) {
+				if (!compaction_faster) break;
+				crossover = selectivity;
+			}
+			ofs << "\n\t" << i << "\t\t\t" << j << "\t\t\t";
+			if (crossover < 0.0) ofs << "never";
+			else ofs << std::setprecision(2) << crossover;
+		}
+		ofs << std::endl;
+
+		ofs.close();
+	}
+
+	// widened integer display
+	template<typename T, template<typename> typename BinOpTransform>
+	auto widened_test_results_display(const std::string_view& data_type,
+		const std::string_view& accumulator_type,
+		const std::string_view& transform_op,
+		const std::string_view& reduce_op,
+		const std::tuple<
+		std::vector<std::tuple<size_t, size_t, double> >,
+		std::vector<std::tuple<size_t, size_t, double> >,
+		std::vector<std::tuple<size_t, size_t, double> >,
+		std::vector<std::tuple<size_t, size_t, double> >,
+		std::vector<std::tuple<size_t, size_t, double> >
+		>& test_results)->void {
+
+		std::ofstream ofs;
+		std::string filename{ data_type };
+		filename += std::string("_") + std::string(accumulator_type);
+		filename += std::string("_") + std::string(transform_op);
+		filename += std::string("_") + std::string(reduce_op);
+		filename += std::string("_widened_tests_results.txt");
+		ofs.open(filename, std::ios::out);
+		if (!ofs) throw std::exception("Exception: Cannot open output file.");
+
+		ofs << "\n\t" << data_type << " (accumulated in " << accumulator_type << ") - " << transform_op << " - " << reduce_op << " test results:\n";
+
+		auto display = [&ofs, &data_type, &accumulator_type, &transform_op, &reduce_op](
+			const std::vector<std::tuple<size_t, size_t, double> >& results,
+			const std::string_view& implementation) {
+			ofs << std::endl
+				<< "\tstd::valarray<" << data_type << "> - accumulator: " << accumulator_type
+				<< " - transformation: " << transform_op << " - reduction: " << reduce_op
+				<< " - implemented by " << implementation << ":"
+				<< "\n\tnumber of tests\t\tsize of data\t\trun-time"
+				<< "\n\t---------------\t\t------------\t\t--------";
+			for (auto& test_i : results) {
+				ofs << "\n\t"
+					<< std::setprecision(9) << std::fixed << std::get<0u>(test_i) << "\t\t\t"
+					<< std::get<1u>(test_i) << "\t\t\t"
+					<< std::get<2u>(test_i);
+			}
+			ofs << std::endl;
+		};
+
+		// tests 16-20 display
+		display(std::get<0u>(test_results), "std::transform_reduce(std::execution::seq, ...)");
+		display(std::get<1u>(test_results), "std::transform_reduce(std::execution::par, ...)");
+		display(std::get<2u>(test_results), "std::transform_reduce(std::execution::par_unseq, ...)");
+		// tests 19-20 fall back to the scalar loop where the kernel has no vector form
+		const bool vectorized{ widening_kernel_vectorized<T, BinOpTransform>() };
+		display(std::get<3u>(test_results), vectorized ? "SIMD widening transform-reduce" : "scalar widening transform-reduce (no SIMD form)");
+		display(std::get<4u>(test_results), vectorized ?
+			"SIMD widening transform-reduce on chunks and std::transform_reduce(std::execution::par, ...)" :
+			"scalar widening transform-reduce (no SIMD form) on chunks and std::transform_reduce(std::execution::par, ...)");
+
+		ofs.close();
+	}
+
+	// page size display
+	template<typename T>
+	auto page_size_test_results_display(const std::string_view& data_type,
+		const std::string_view& transform_op,
+		const std::string_view& reduce_op,
+		const std::tuple<
+		std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >,
+		std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >,
+		std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >,
+		std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >
+		>& test_results)->void {
+
+		std::ofstream ofs;
+		std::string filename{ data_type };
+		filename += std::string("_") + std::string(transform_op);
+		filename += std::string("_") + std::string(reduce_op);
+		filename += std::string("_page_size_tests_results.txt");
+		ofs.open(filename, std::ios::out);
+		if (!ofs) throw std::exception("Exception: Cannot open output file.");
+
+		ofs << "\n\t" << data_type << " - " << transform_op << " - " << reduce_op << " page size test results:\n"
+			<< "\n\tdTLB misses: seq tests counted on the calling thread, par tests summed over one counter per CPU"
+			<< " (system-wide, other processes included); n/a where perf_event_open is not permitted"
+			<< "\n\t2 MB share: share of the two input buffers the operating system backs by 2 MB pages"
+			<< "\n\tfallbacks: input buffers requested on 2 MB pages but not entirely backed by them\n";
+
+		auto display = [&ofs, &data_type, &transform_op, &reduce_op](
+			const std::vector<std::tuple<size_t, size_t, double, std::int64_t, double, size_t> >& results,
+			const std::string_view& implementation) {
+			ofs << std::endl
+				<< "\tstd::vector<" << data_type << "> - transformation: " << transform_op << " - reduction: " << reduce_op
+				<< " - implemented by " << implementation << ":"
+				<< "\n\tnumber of tests\t\tsize of data\t\trun-time\t\tdTLB misses\t\t2 MB share\t\tfallbacks"
+				<< "\n\t---------------\t\t------------\t\t--------\t\t-----------\t\t----------\t\t---------";
+			for (auto& test_i : results) {
+				ofs << "\n\t"
+					<< std::setprecision(9) << std::fixed << std::get<0u>(test_i) << "\t\t\t"
+					<< std::get<1u>(test_i) << "\t\t\t"
+					<< std::get<2u>(test_i) << "\t\t";
+				if (std::get<3u>(test_i) < 0) ofs << "n/a";
+				else ofs << std::get<3u>(test_i);
+				ofs << "\t\t\t";
+				if (std::get<4u>(test_i) < 0.0) ofs << "n/a\t\t\tn/a";
+				else ofs << std::setprecision(2) << std::get<4u>(test_i) << "\t\t\t" << std::get<5u>(test_i);
+			}
+			ofs << std::endl;
+		};
+
+		// tests 21-24 display
+		display(std::get<0u>(test_results), "std::transform_reduce(std::execution::seq, ...) on 4 KB pages");
+		display(std::get<1u>(test_results), "std::transform_reduce(std::execution::seq, ...) on 2 MB pages");
+		display(std::get<2u>(test_results), "std::transform_reduce(std::execution::par, ...) on 4 KB pages");
+		display(std::get<3u>(test_results), "std::transform_reduce(std::execution::par, ...) on 2 MB pages");
+
+		ofs.close();
+	}
+
+	// traced chunks display and Chrome trace / Perfetto JSON export
+	template<typename T>
+	auto traced_test_results_display(const std::string_view& data_type,
+		const std::string_view& transform_op,
+		const std::string_view& reduce_op,
+		const std::tuple<
+		std::vector<std::tuple<size_t, size_t, size_t, double, size_t, double, double, double, double> >,
+		std::vector<std::tuple<size_t, size_t, size_t, double, size_t, double, double, double, double> >,
+		std::vector<chunk_trace>
+		>& test_results)->void {
+
+		std::ofstream ofs;
+		std::string filename{ data_type };
+		filename += std::string("_") + std::string(transform_op);
+		filename += std::string("_") + std::string(reduce_op);
+		ofs.open(filename + std::string("_traced_tests_results.txt"), std::ios::out);
+		if (!ofs) throw std::exception("Exception: Cannot open output file.");
+
+		ofs << "\n\t" << data_type << " - " << transform_op << " - " << reduce_op << " traced test results:\n"
+			<< "\n\ttraced runs: runs whose chunks were all retained by the trace rings, the summary columns average over them"
+			<< "\n\tthreads: mean number of threads that executed at least one chunk"
+			<< "\n\tload imbalance: busiest thread time / mean time of all available threads (1 is perfect balance)"
+			<< "\n\tidle fraction: share of available threads x wall-time not spent in chunks"
+			<< "\n\tstraggler ratio: slowest chunk time / mean chunk time\n";
+
+		auto display = [&ofs, &data_type, &transform_op, &reduce_op](
+			const std::vector<std::tuple<size_t, size_t, size_t, double, size_t, double, double, double, double> >& results,
+			const std::string_view& implementation) {
+			ofs << std::endl
+				<< "\tstd::valarray<" << data_type << "> - transformation: " << transform_op << " - reduction: " << reduce_op
+				<< " - implemented by " << implementation << ":"
+				<< "\n\tnumber of tests\t\tsize of data\t\tnumber of chunks\trun-time\t\ttraced runs\tthreads\t\tload imbalance\t\tidle fraction\t\tstraggler ratio"
+				<< "\n\t---------------\t\t------------\t\t----------------\t--------\t\t-----------\t-------\t\t--------------\t\t-------------\t\t---------------";
+			for (auto& test_i : results) {
+				ofs << "\n\t"
+					<< std::setprecision(9) << std::fixed << std::get<0u>(test_i) << "\t\t\t"
+					<< std::get<1u>(test_i) << "\t\t\t"
+					<< std::get<2u>(test_i) << "\t\t\t"
+					<< std::get<3u>(test_i) << "\t\t"
+					<< std::get<4u>(test_i) << "\t\t"
+					<< std::setprecision(1) << std::get<5u>(test_i) << "\t\t"
+					<< std::setprecision(3) << std::get<6u>(test_i) << "\t\t\t"
+					<< std::get<7u>(test_i) << "\t\t\t"
+					<< std::get<8u>(test_i);
+			}
+			ofs << std::endl;
+		};
+
+		// tests 25, 26 display
+		display(std::get<0u>(test_results), "traced chunks of std::transform_reduce distributed by std::transform_reduce(std::execution::par, ...)");
+		display(std::get<1u>(test_results), "traced chunks of std::transform_reduce distributed by std::transform_reduce(std::execution::par_unseq, ...)");
+
+		ofs.close();
+
+		// open in chrome://tracing or ui.perfetto.dev
+		ofs.open(filename + std::string("_chunk_trace.json"), std::ios::out);
+		if (!ofs) throw std::exception("Exception: Cannot open output file.");
+		chunk_tracer::export_chrome_trace(ofs, std::get<2u>(test_results));
+		ofs.close();
+	}
+
+	// mixed-precision display
+	template<typename S, typename A, template<typename> typename BinOpTransform>
+	auto mixed_precision_test_results_display(const std::string_view& storage_type,
+		const std::string_view& accumulator_type,
+		const std::string_view& transform_op,
+		const std::string_view& reduce_op,
+		const std::tuple<
+		std::vector<std::tuple<size_t, size_t, double, double, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double, double, double> >,
+		std::vector<std::tuple<size_t, size_t, double, double, double, double> >
+		>& test_results)->void {
+
+		std::ofstream ofs;
+		std::string filename{ storage_type };
+		filename += std::string("_") + std::string(accumulator_type);
+		filename += std::string("_") + std::string(transform_op);
+		filename += std::string("_") + std::string(reduce_op);
+		filename += std::string("_mixed_precision_tests_results.txt");
+		ofs.open(filename, std::ios::out);
+		if (!ofs) throw std::exception("Exception: Cannot open output file.");
+
+		ofs << "\n\t" << storage_type << " (accumulated in " << accumulator_type << ") - " << transform_op << " - " << reduce_op << " test results:\n"
+			<< "\n\ttotal error: relative error against the double reference of the unrounded data"
+			<< "\n\taccumulation error: relative error against the double reference of the stored data\n";
+
+		auto display = [&ofs, &storage_type, &accumulator_type, &transform_op, &reduce_op](
+			const std::vector<std::tuple<size_t, size_t, double, double, double, double> >& results,
+			const std::string_view& implementation) {
+			ofs << std::endl
+				<< "\tstd::vector<" << storage_type << "> - accumulator: " << accumulator_type
+				<< " - transformation: " << transform_op << " - reduction: " << reduce_op
+				<< " - implemented by " << implementation << ":"
+				<< "\n\tnumber of tests\t\tsize of data\t\trun-time\t\tthroughput (GB/s)\ttotal error\t\taccumulation error"
+				<< "\n\t---------------\t\t------------\t\t--------\t\t-----------------\t-----------\t\t------------------";
+			for (auto& test_i : results) {
+				ofs << "\n\t"
+					<< std::setprecision(9) << std::fixed << std::get<0u>(test_i) << "\t\t\t"
+					<< std::get<1u>(test_i) << "\t\t\t"
+					<< std::get<2u>(test_i) << "\t\t"
+					<< std::setprecision(3) << std::get<3u>(test_i) << "\t\t\t"
+					<< std::scientific << std::get<4u>(test_i) << "\t\t"
+					<< std::get<5u>(test_i);
+			}
+			ofs << std::endl;
+		};
+
+		// the kernel of tests 29 and 30 falls back to a scalar loop when the build or the host lacks the ISA
+		const std::string kernel{ !mixed_precision_kernel_vectorized<S, A, BinOpTransform>() ? "scalar convert" :
+			std::is_same_v<BinOpTransform<A>, std::multiplies<A> > ? "SIMD convert and FMA" : "SIMD convert and add" };
+
+		// tests 27-30 display
+		display(std::get<0u>(test_results), "std::transform_reduce(std::execution::seq, ...)");
+		display(std::get<1u>(test_results), "std::transform_reduce(std::execution::par, ...)");
+		display(std::get<2u>(test_results), kernel + " transform-reduce");
+		display(std::get<3u>(test_results), kernel + " transform-reduce on chunks and std::transform_reduce(std::execution::par, ...)");
+
+		ofs.close();
+	}
 }
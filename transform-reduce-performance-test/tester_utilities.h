@@ -0,0 +1,86 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*      Helpers shared by the testers: chunked parallel reduction, result comparison within      */
+/*                   rounding error and timing of repeated measured reductions.                  */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <type_traits>
+#include <algorithm>
+#include <execution>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include <chrono>
+#include <vector>
+#include <limits>
+#include <thread>
+#include <cmath>
+
+namespace {
+
+	// indices of chunks_per_thread chunks for every hardware thread
+	inline auto chunk_indices(size_t chunks_per_thread)->std::vector<size_t> {
+		std::vector<size_t> chunks(std::max(1u, std::thread::hardware_concurrency()) * chunks_per_thread);
+		std::iota(std::begin(chunks), std::end(chunks), size_t(0));
+		return chunks;
+	}
+
+	// element range [lo, hi) of chunk c when n elements are split into m chunks
+	constexpr auto chunk_bounds(size_t n, size_t c, size_t m)->std::pair<size_t, size_t> {
+		return { n * c / m, n * (c + 1u) / m };
+	}
+
+	// reduces op(lo, hi) over the element ranges of the chunks,
+	// the chunks are distributed over the threads with the given execution policy
+	template<typename ExecutionPolicy, typename R, typename BinOpReduce, typename ChunkOp>
+	auto chunked_transform_reduce(ExecutionPolicy&& policy, const std::vector<size_t>& chunks, size_t n,
+		R init, BinOpReduce reduce, ChunkOp op)->R {
+		const size_t m{ chunks.size() };
+		return std::transform_reduce(std::forward<ExecutionPolicy>(policy),
+			std::begin(chunks),
+			std::end(chunks),
+			init,
+			reduce,
+			[&op, n, m](size_t c) {
+				const auto bounds{ chunk_bounds(n, c, m) };
+				return op(bounds.first, bounds.second);
+			});
+	}
+
+	// equality of two reductions of n elements: implementations that change the order
+	// of evaluation may differ in floating-point results by the accumulated rounding error
+	template<typename T>
+	auto same_result(T x, T y, size_t n)->bool {
+		if constexpr (std::is_floating_point_v<T>)
+			return std::abs(x - y) <= std::numeric_limits<T>::epsilon() * T(n) * std::max(T(1), std::abs(y));
+		else
+			return x == y;
+	}
+
+	// keeps the optimizer from discarding the measured reductions:
+	// every byte of every result is folded into it
+	inline volatile unsigned char result_sink{ 0u };
+
+	// run-time of i repetitions of f, which is passed the repetition index if it takes one
+	template<typename F>
+	auto timed_repetitions(size_t i, F&& f)->double {
+		auto ti{ std::chrono::high_resolution_clock::now() };
+
+		for (size_t ii{ 0u }; ii < i; ++ii) {
+			const auto result{ [&f, ii]() {
+				if constexpr (std::is_invocable_v<F&, size_t>) return f(ii);
+				else return f();
+			}() };
+			unsigned char folded{ 0u };
+			for (size_t k{ 0u }; k < sizeof(result); ++k) folded ^= reinterpret_cast<const unsigned char*>(&result)[k];
+			result_sink = folded;
+		}
+
+		auto tf{ std::chrono::high_resolution_clock::now() };
+		return std::chrono::duration<double>(tf - ti).count();
+	}
+}
@@ -0,0 +1,111 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*      Data TLB miss counter on top of the Linux perf_event interface, either for the calling   */
+/*      thread and its children or system-wide on every CPU; it is unavailable elsewhere.        */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#endif
+
+namespace {
+
+	// whose dTLB misses are counted: the calling thread and any thread it creates while
+	// counting, or every thread on every CPU with one counter per CPU, other processes
+	// included, which needs perf_event_paranoid <= 0 or CAP_PERFMON
+	enum class tlb_miss_scope { calling_thread, all_cpus };
+
+	class tlb_miss_counter {
+	public:
+		explicit tlb_miss_counter(tlb_miss_scope scope = tlb_miss_scope::calling_thread) {
+#if defined(__linux__)
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.size = sizeof(attr);
+			attr.config = PERF_COUNT_HW_CACHE_DTLB |
+				(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+
+			if (scope == tlb_miss_scope::calling_thread) {
+				attr.inherit = 1;
+				auto fd{ open_counter(attr, 0, -1) };
+				if (fd >= 0) fds_.push_back(fd);
+			}
+			else {
+				const long cpus{ sysconf(_SC_NPROCESSORS_CONF) };
+				for (long cpu{ 0 }; cpu < cpus; ++cpu) {
+					auto fd{ open_counter(attr, -1, static_cast<int>(cpu)) };
+					if (fd >= 0) fds_.push_back(fd);
+					else if (errno != ENODEV) {	// offline CPUs are skipped, any other failure disables the counter
+						close_all();
+						break;
+					}
+				}
+			}
+#else
+			(void)scope;
+#endif
+		}
+		~tlb_miss_counter() { close_all(); }
+		tlb_miss_counter(const tlb_miss_counter&) = delete;
+		auto operator=(const tlb_miss_counter&)->tlb_miss_counter& = delete;
+
+		auto available() const->bool { return !fds_.empty(); }
+
+		auto start()->void {
+#if defined(__linux__)
+			for (auto fd : fds_) ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			for (auto fd : fds_) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+		}
+
+		// dTLB load misses since start(), summed over the counters, -1 if no counter is available
+		auto stop()->std::int64_t {
+#if defined(__linux__)
+			if (fds_.empty()) return -1;
+			for (auto fd : fds_) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+			std::int64_t total{ 0 };
+			for (auto fd : fds_) {
+				std::uint64_t count{ 0u };
+				if (read(fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) return -1;
+				total += static_cast<std::int64_t>(count);
+			}
+			return total;
+#else
+			return -1;
+#endif
+		}
+
+	private:
+#if defined(__linux__)
+		static auto open_counter(perf_event_attr& attr, pid_t pid, int cpu)->int {
+			return static_cast<int>(syscall(__NR_perf_event_open, &attr, pid, cpu, -1, 0));
+		}
+#endif
+
+		auto close_all()->void {
+#if defined(__linux__)
+			for (auto fd : fds_) close(fd);
+#endif
+			fds_.clear();
+		}
+
+		std::vector<int> fds_;
+	};
+}
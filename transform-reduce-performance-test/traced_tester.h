@@ -0,0 +1,191 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*       Traced parallel transform-reduce performance tests: the harness partitions the data     */
+/*      into chunks itself, so every chunk can be traced to its thread, range and time span.     */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <algorithm>
+#include <execution>
+#include <valarray>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <limits>
+#include <thread>
+#include <string>
+#include <tuple>
+#include <cmath>
+
+#include "simd_kernels.h"
+#include "chunk_tracer.h"
+#include "tester_utilities.h"
+
+namespace {
+
+	// a platform for tracing how parallel transform-reduce work is
+	// distributed over the threads, for distinct numbers of chunks
+	//
+	// every result is { number of tests, size of data, number of chunks, run-time, traced runs
+	// summarized, threads that executed chunks, load imbalance, idle fraction, straggler ratio },
+	// the chunk traces of the last exported_runs runs of every measurement are returned for export
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto traced_transform_reduce_test(
+		const std::vector<size_t>& nIter,
+		const std::vector<size_t>& szData,
+		const std::vector<size_t>& chunksPerThread,
+		size_t exported_runs = 2u)->std::tuple<
+		std::vector<std::tuple<size_t, size_t, size_t, double, size_t, double, double, double, double> >,
+		std::vector<std::tuple<size_t, size_t, size_t, double, size_t, double, double, double, double> >,
+		std::vector<chunk_trace>
+		> {
+		if constexpr (std::is_arithmetic_v<T> &&
+			std::is_invocable_r_v<T, BinOpReduce<T>, const T&, const T&> &&
+			std::is_invocable_r_v<T, BinOpTransform<T>, const T&, const T&>) {
+
+			// tests result
+			std::vector<std::tuple<size_t, size_t, size_t, double, size_t, double, double, double, double> > test_25_results;
+			std::vector<std::tuple<size_t, size_t, size_t, double, size_t, double, double, double, double> > test_26_results;
+			std::vector<chunk_trace> traces;
+
+			const size_t nThreads{ std::max(1u, std::thread::hardware_concurrency()) };
+
+			// random number distribution preparation
+			std::random_device rd;
+			std::default_random_engine rng{ rd() };
+
+			// test case std::valarrays initialization by uniform distributed random numbers
+			auto random_data = [&rng](size_t n) {
+				std::valarray<T> a(T(0), n), b(T(0), n);
+				if constexpr (std::is_integral_v<T>) {
+					constexpr T lower_limit = std::numeric_limits<T>::min(), upper_limit = std::numeric_limits<T>::max();
+					std::uniform_int_distribution<T> rnd(lower_limit, upper_limit);
+					std::generate(std::begin(a), std::end(a), [&rng, &rnd]() { return rnd(rng); });
+					std::generate(std::begin(b), std::end(b), [&rng, &rnd]() { return rnd(rng); });
+				}
+				else if constexpr (std::is_floating_point_v<T>) {
+					constexpr T lower_limit = T(0), upper_limit = T(1);
+					std::uniform_real_distribution<T> rnd(lower_limit, upper_limit);
+					std::generate(std::begin(a), std::end(a), [&rng, &rnd]() { return rnd(rng); });
+					std::generate(std::begin(b), std::end(b), [&rng, &rnd]() { return rnd(rng); });
+				}
+				return std::make_pair(std::move(a), std::move(b));
+			};
+
+			// chunked transform-reduce: the outer transform_reduce distributes the chunks
+			// over the threads with the given execution policy, every chunk is traced
+			auto chunked = [](chunk_tracer& tracer, auto&& policy, const std::valarray<T>& a, const std::valarray<T>& b,
+				const std::vector<size_t>& chunks, std::uint32_t run) {
+				return chunked_transform_reduce(policy, chunks, a.size(), reduction_identity<T, BinOpReduce>(), BinOpReduce<T>(),
+					[&a, &b, &tracer, run](size_t lo, size_t hi) {
+						const auto ti{ tracer.now() };
+						auto partial{ std::transform_reduce(
+							std::begin(a) + lo,
+							std::begin(a) + hi,
+							std::begin(b) + lo,
+							reduction_identity<T, BinOpReduce>(),
+							BinOpReduce<T>(),
+							BinOpTransform<T>()) };
+						tracer.record(run, lo, hi, ti, tracer.now());
+						return partial;
+					});
+			};
+
+			// correctness of results validation
+			auto validation = [&, n = szData[0u]]()->bool {
+				auto data{ random_data(n) };
+				auto& a{ data.first };
+				auto& b{ data.second };
+				auto chunks{ chunk_indices(chunksPerThread.back()) };
+
+				auto reference{ std::transform_reduce(std::execution::seq,
+					std::begin(a),
+					std::end(a),
+					std::begin(b),
+					reduction_identity<T, BinOpReduce>(),
+					BinOpReduce<T>(),
+					BinOpTransform<T>()) };
+
+				// every element must be covered by exactly one traced chunk, whatever the policy
+				chunk_tracer tracer(chunks.size());
+				auto traced = [&](auto&& policy)->bool {
+					tracer.clear();
+					auto res{ chunked(tracer, policy, a, b, chunks, 0u) };
+					auto events{ tracer.events() };
+					size_t covered{ 0u };
+					for (auto& e : events) covered += static_cast<size_t>(e.last - e.first);
+					return same_result(res, reference, n) && covered == n &&
+						chunk_tracer::summarize(events, nThreads, n).runs == 1u;
+				};
+
+				return traced(std::execution::par) && traced(std::execution::par_unseq);
+			};
+			if (validation()) {
+
+				// run-time of i traced repetitions of f over n elements in m chunks, followed by the
+				// trace summary; the rings hold twice the chunks of an even share of the runs, so a
+				// thread that executes more than that overwrites its oldest runs, which are then
+				// not summarized
+				auto speed_test = [&](size_t i, size_t n, size_t m, const std::string& label, auto&& f) {
+					chunk_tracer tracer(2u * i * m / nThreads + m);
+					auto Δt{ timed_repetitions(i, [&f, &tracer](size_t ii) { return f(tracer, static_cast<std::uint32_t>(ii)); }) };
+
+					auto events{ tracer.events() };
+					auto summary{ chunk_tracer::summarize(events, nThreads, n) };
+					const auto first_exported{ static_cast<std::uint32_t>(i > exported_runs ? i - exported_runs : 0u) };
+					events.erase(std::remove_if(std::begin(events), std::end(events),
+						[first_exported](const chunk_event& e) { return e.run < first_exported; }), std::end(events));
+					traces.push_back(chunk_trace{ label, std::move(events) });
+					return std::make_pair(Δt, summary);
+				};
+
+				// test procedure...
+				for (auto i : nIter) {
+					for (auto j : szData) {
+
+						// test cases data structures
+						auto data{ random_data(j) };
+						auto& a{ data.first };
+						auto& b{ data.second };
+
+						for (auto k : chunksPerThread) {
+							auto chunks{ chunk_indices(k) };
+							const auto cell{ std::to_string(i) + " x " + std::to_string(j) + " elements, " + std::to_string(chunks.size()) + " chunks" };
+
+							/*******************************************************************************/
+							/*          test 25 { traced chunks, std::transform_reduce(par,...) }          */
+							/*******************************************************************************/
+							auto [Δt25, summary25] = speed_test(i, j, chunks.size(), "test 25 (par): " + cell,
+								[&](chunk_tracer& tracer, std::uint32_t run) { return chunked(tracer, std::execution::par, a, b, chunks, run); });
+							test_25_results.push_back(std::make_tuple(i, j, chunks.size(), Δt25,
+								summary25.runs, summary25.threads, summary25.imbalance, summary25.idle, summary25.straggler));
+
+							/*******************************************************************************/
+							/*       test 26 { traced chunks, std::transform_reduce(par_unseq,...) }       */
+							/*******************************************************************************/
+							auto [Δt26, summary26] = speed_test(i, j, chunks.size(), "test 26 (par_unseq): " + cell,
+								[&](chunk_tracer& tracer, std::uint32_t run) { return chunked(tracer, std::execution::par_unseq, a, b, chunks, run); });
+							test_26_results.push_back(std::make_tuple(i, j, chunks.size(), Δt26,
+								summary26.runs, summary26.threads, summary26.imbalance, summary26.idle, summary26.straggler));
+						}
+					}
+				}
+
+				return std::make_tuple(
+					std::move(test_25_results),
+					std::move(test_26_results),
+					std::move(traces));
+			}
+			else
+				throw std::exception("Exception: Traced correcteness test results don't have same values.");
+		}
+	}
+}
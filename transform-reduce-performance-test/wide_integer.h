@@ -0,0 +1,112 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*       Widened accumulator types for overflow-safe integer transform-reduce operations:        */
+/*                         int32 -> int64 and int64 -> int128 accumulation.                      */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <type_traits>
+#include <functional>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+#if defined(__SIZEOF_INT128__)
+	using int128_t = __int128;
+#else
+	// two's complement 128-bit integer providing just the operations the
+	// widened reductions need (the compiler has no native 128-bit type)
+	struct int128_t {
+		std::uint64_t lo{ 0u };
+		std::uint64_t hi{ 0u };
+
+		constexpr int128_t() = default;
+		constexpr int128_t(std::int64_t x) :
+			lo(static_cast<std::uint64_t>(x)),
+			hi(x < 0 ? ~std::uint64_t(0) : std::uint64_t(0)) {}
+
+		friend constexpr auto operator+(const int128_t& x, const int128_t& y)->int128_t {
+			int128_t r;
+			r.lo = x.lo + y.lo;
+			r.hi = x.hi + y.hi + (r.lo < x.lo ? 1u : 0u);
+			return r;
+		}
+		friend constexpr auto operator-(const int128_t& x)->int128_t {
+			int128_t r;
+			r.lo = ~x.lo + 1u;
+			r.hi = ~x.hi + (r.lo == 0u ? 1u : 0u);
+			return r;
+		}
+		friend constexpr auto operator==(const int128_t& x, const int128_t& y)->bool { return x.lo == y.lo && x.hi == y.hi; }
+		friend constexpr auto operator!=(const int128_t& x, const int128_t& y)->bool { return !(x == y); }
+	};
+#endif
+
+	// 128-bit integer from its high (signed) and low (unsigned) 64-bit halves
+	constexpr auto make_int128(std::int64_t hi, std::uint64_t lo)->int128_t {
+#if defined(__SIZEOF_INT128__)
+		return static_cast<int128_t>((static_cast<unsigned __int128>(static_cast<std::uint64_t>(hi)) << 64) | lo);
+#else
+		int128_t r;
+		r.lo = lo;
+		r.hi = static_cast<std::uint64_t>(hi);
+		return r;
+#endif
+	}
+
+	// full 64 x 64 -> 128 bit signed product
+	constexpr auto wide_multiply(std::int64_t x, std::int64_t y)->int128_t {
+#if defined(__SIZEOF_INT128__)
+		return int128_t(x) * int128_t(y);
+#else
+		// schoolbook product of the magnitudes on 32-bit halves
+		const bool negative{ (x < 0) != (y < 0) };
+		const std::uint64_t u{ x < 0 ? ~static_cast<std::uint64_t>(x) + 1u : static_cast<std::uint64_t>(x) };
+		const std::uint64_t v{ y < 0 ? ~static_cast<std::uint64_t>(y) + 1u : static_cast<std::uint64_t>(y) };
+		const std::uint64_t u0{ u & 0xffffffffu }, u1{ u >> 32 }, v0{ v & 0xffffffffu }, v1{ v >> 32 };
+		const std::uint64_t p00{ u0 * v0 }, p01{ u0 * v1 }, p10{ u1 * v0 }, p11{ u1 * v1 };
+		const std::uint64_t middle{ (p00 >> 32) + (p01 & 0xffffffffu) + (p10 & 0xffffffffu) };
+		int128_t r;
+		r.lo = (middle << 32) | (p00 & 0xffffffffu);
+		r.hi = p11 + (p01 >> 32) + (p10 >> 32) + (middle >> 32);
+		return negative ? -r : r;
+#endif
+	}
+
+	// accumulator type twice as wide as the element type
+	template<typename T>
+	struct widened;
+
+	template<>
+	struct widened<std::int32_t> { using type = std::int64_t; };
+
+	template<>
+	struct widened<std::int64_t> { using type = int128_t; };
+
+	template<typename T>
+	using widened_t = typename widened<T>::type;
+
+	// number of value bits of the widened accumulator
+	template<typename T>
+	constexpr int widened_digits_v = static_cast<int>(8u * sizeof(widened_t<T>)) - 1;
+
+	// transformation evaluated in the widened type, so neither the
+	// transformation nor the following reduction can overflow
+	template<typename T, template<typename> typename BinOpTransform>
+	struct widened_transform {
+		constexpr auto operator()(const T& x, const T& y) const->widened_t<T> {
+			if constexpr (std::is_same_v<BinOpTransform<T>, std::multiplies<T> >) {
+				if constexpr (std::is_same_v<widened_t<T>, int128_t>) return wide_multiply(x, y);
+				else return widened_t<T>(x) * widened_t<T>(y);
+			}
+			else {
+				static_assert(std::is_same_v<BinOpTransform<T>, std::plus<T> >, "transformation without a widened form");
+				return widened_t<T>(x) + widened_t<T>(y);
+			}
+		}
+	};
+}
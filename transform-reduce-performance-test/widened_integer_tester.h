@@ -0,0 +1,189 @@
+﻿
+/*************************************************************************************************/
+/*                                                                                               */
+/*        Overflow-safe integer transform-reduce performance tests: the elements keep their      */
+/*      storage type, transformation and reduction are carried out in a type twice as wide.      */
+/*                                                                                               */
+/*************************************************************************************************/
+
+#pragma once
+
+#include <functional>
+#include <algorithm>
+#include <execution>
+#include <valarray>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <chrono>
+#include <vector>
+#include <limits>
+#include <thread>
+#include <tuple>
+#include <cmath>
+
+#include "wide_integer.h"
+#include "simd_kernels.h"
+#include "tester_utilities.h"
+
+namespace {
+
+	// a platform for testing widened integer transform-reduce
+	// implementations against an exact reference
+	template<typename T,
+		template<typename> typename BinOpReduce,
+		template<typename> typename BinOpTransform>
+	auto widened_transform_reduce_test(
+		const std::vector<size_t>& nIter,
+		const std::vector<size_t>& szData)->std::tuple<
+		std::vector<std::tuple<size_t, size_t, double> >,
+		std::vector<std::tuple<size_t, size_t, double> >,
+		std::vector<std::tuple<size_t, size_t, double> >,
+		std::vector<std::tuple<size_t, size_t, double> >,
+		std::vector<std::tuple<size_t, size_t, double> >
+		> {
+		if constexpr (std::is_integral_v<T> && std::is_signed_v<T> &&
+			std::is_same_v<BinOpReduce<T>, std::plus<T> >) {
+
+			using W = widened_t<T>;
+
+			// tests result
+			std::vector<std::tuple<size_t, size_t, double> > test_16_results;
+			std::vector<std::tuple<size_t, size_t, double> > test_17_results;
+			std::vector<std::tuple<size_t, size_t, double> > test_18_results;
+			std::vector<std::tuple<size_t, size_t, double> > test_19_results;
+			std::vector<std::tuple<size_t, size_t, double> > test_20_results;
+
+			// largest input magnitude for which the sum of the transformation of the
+			// largest data set still fits in the widened type (with one bit of headroom)
+			const T bound = [n = *std::max_element(std::begin(szData), std::end(szData))]() {
+				const long double limit{ std::ldexp(1.0L, widened_digits_v<T> - 1) / static_cast<long double>(n) };
+				const long double bound{ std::is_same_v<BinOpTransform<T>, std::multiplies<T> > ? std::sqrt(limit) : limit / 2.0L };
+				constexpr T upper_limit = std::numeric_limits<T>::max();
+				return bound >= static_cast<long double>(upper_limit) ? upper_limit : static_cast<T>(bound);
+			}();
+
+			// random number distribution preparation
+			std::random_device rd;
+			std::default_random_engine rng{ rd() };
+
+			// test case std::valarrays initialization by uniform distributed random numbers
+			auto random_data = [&rng, bound](size_t n) {
+				std::valarray<T> a(T(0), n), b(T(0), n);
+				std::uniform_int_distribution<T> rnd(-bound, bound);
+				std::generate(std::begin(a), std::end(a), [&rng, &rnd]() { return rnd(rng); });
+				std::generate(std::begin(b), std::end(b), [&rng, &rnd]() { return rnd(rng); });
+				return std::make_pair(std::move(a), std::move(b));
+			};
+
+			// test 16 { std::transform_reduce(seq,...) into the widened type }
+			auto widened_seq = [](const std::valarray<T>& a, const std::valarray<T>& b) {
+				return std::transform_reduce(std::execution::seq,
+					std::begin(a),
+					std::end(a),
+					std::begin(b),
+					W(0),
+					std::plus<W>(),
+					widened_transform<T, BinOpTransform>());
+			};
+
+			// test 17 { std::transform_reduce(par,...) into the widened type }
+			auto widened_par = [](const std::valarray<T>& a, const std::valarray<T>& b) {
+				return std::transform_reduce(std::execution::par,
+					std::begin(a),
+					std::end(a),
+					std::begin(b),
+					W(0),
+					std::plus<W>(),
+					widened_transform<T, BinOpTransform>());
+			};
+
+			// test 18 { std::transform_reduce(par_unseq,...) into the widened type }
+			auto widened_par_unseq = [](const std::valarray<T>& a, const std::valarray<T>& b) {
+				return std::transform_reduce(std::execution::par_unseq,
+					std::begin(a),
+					std::end(a),
+					std::begin(b),
+					W(0),
+					std::plus<W>(),
+					widened_transform<T, BinOpTransform>());
+			};
+
+			// test 19 { SIMD widening transform-reduce, scalar for int64 products }
+			auto widened_simd = [](const std::valarray<T>& a, const std::valarray<T>& b) {
+				return widening_transform_reduce<T, BinOpReduce, BinOpTransform>(std::begin(a), std::begin(b), a.size());
+			};
+
+			// test 20 { SIMD widening transform-reduce on chunks, chunks reduced by std::transform_reduce(par,...) }
+			auto widened_par_simd = [chunks = chunk_indices(4u)](const std::valarray<T>& a, const std::valarray<T>& b) {
+				return chunked_transform_reduce(std::execution::par, chunks, a.size(), W(0), std::plus<W>(),
+					[&a, &b](size_t lo, size_t hi) {
+						return widening_transform_reduce<T, BinOpReduce, BinOpTransform>(std::begin(a) + lo, std::begin(b) + lo, hi - lo);
+					});
+			};
+
+			// correctness of results validation against an exact 128-bit reference
+			auto validation = [&, n = szData[0u]]()->bool {
+				auto data{ random_data(n) };
+				auto& a{ data.first };
+				auto& b{ data.second };
+
+				int128_t reference{ 0 };
+				for (size_t k{ 0u }; k < n; ++k) reference = reference + int128_t(widened_transform<T, BinOpTransform>()(a[k], b[k]));
+
+				return int128_t(widened_seq(a, b)) == reference &&
+					int128_t(widened_par(a, b)) == reference &&
+					int128_t(widened_par_unseq(a, b)) == reference &&
+					int128_t(widened_simd(a, b)) == reference &&
+					int128_t(widened_par_simd(a, b)) == reference;
+			};
+			if (validation()) {
+
+				// test procedure...
+				for (auto i : nIter) {
+					for (auto j : szData) {
+
+						// test cases data structures
+						auto data{ random_data(j) };
+						auto& a{ data.first };
+						auto& b{ data.second };
+
+						/*******************************************************************************/
+						/*           test 16 { std::transform_reduce(seq,...), widened }               */
+						/*******************************************************************************/
+						test_16_results.push_back(std::make_tuple(i, j, timed_repetitions(i, [&]() { return widened_seq(a, b); })));
+
+						/*******************************************************************************/
+						/*           test 17 { std::transform_reduce(par,...), widened }               */
+						/*******************************************************************************/
+						test_17_results.push_back(std::make_tuple(i, j, timed_repetitions(i, [&]() { return widened_par(a, b); })));
+
+						/*******************************************************************************/
+						/*        test 18 { std::transform_reduce(par_unseq,...), widened }            */
+						/*******************************************************************************/
+						test_18_results.push_back(std::make_tuple(i, j, timed_repetitions(i, [&]() { return widened_par_unseq(a, b); })));
+
+						/*******************************************************************************/
+						/*              test 19 { SIMD widening transform-reduce }                     */
+						/*******************************************************************************/
+						test_19_results.push_back(std::make_tuple(i, j, timed_repetitions(i, [&]() { return widened_simd(a, b); })));
+
+						/*******************************************************************************/
+						/*         test 20 { parallel chunks of SIMD widening transform-reduce }       */
+						/*******************************************************************************/
+						test_20_results.push_back(std::make_tuple(i, j, timed_repetitions(i, [&]() { return widened_par_simd(a, b); })));
+					}
+				}
+
+				return std::make_tuple(
+					std::move(test_16_results),
+					std::move(test_17_results),
+					std::move(test_18_results),
+					std::move(test_19_results),
+					std::move(test_20_results));
+			}
+			else
+				throw std::exception("Exception: Widened correcteness test results don't match the exact reference.");
+		}
+	}
+}